@@ -0,0 +1,373 @@
+#include "ns3/core-module.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/wifi-helper.h"
+#include "ns3/applications-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/udp-client-server-helper.h"
+#include "ns3/seq-ts-header.h"
+#include "ns3/ssid.h"
+#include "ns3/node-list.h"
+#include "ns3/multi-link-device-helper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+using namespace ns3;
+
+/*
+ * Per-station statistics, kept as one array per counter instead of one object
+ * per application: station id = bss * nStaPerBss + sta indexes every array.
+ * A received packet updates one element in four of the arrays; the report
+ * walks each array linearly whatever the number of stations.
+ */
+struct StationStats
+{
+	std::vector<uint64_t> txPackets;	/* packets generated by the station */
+	std::vector<uint64_t> rxPackets;	/* packets of the station received by its AP */
+	std::vector<uint64_t> rxBytes;		/* bytes of the station received by its AP */
+	std::vector<int64_t> latencySum;	/* sum of the latencies (ns) */
+	std::vector<int64_t> latencyMax;	/* worst latency (ns) */
+
+	void Resize(uint32_t nStations)
+	{
+		txPackets.assign(nStations, 0);
+		rxPackets.assign(nStations, 0);
+		rxBytes.assign(nStations, 0);
+		latencySum.assign(nStations, 0);
+		latencyMax.assign(nStations, 0);
+	}
+};
+
+/**
+ * @brief account a packet received from a station
+ *
+ * param stats per-station statistics
+ * param station station id of the sender
+ * param bytes size of the packet
+ * param latency time since the packet was generated
+ *
+ */
+void CountRx(StationStats *stats, uint32_t station, uint32_t bytes, Time latency)
+{
+	int64_t ns = latency.GetNanoSeconds();
+	stats->rxPackets[station]++;
+	stats->rxBytes[station] += bytes;
+	stats->latencySum[station] += ns;
+	if(ns > stats->latencyMax[station])
+	{
+		stats->latencyMax[station] = ns;
+	}
+}
+
+/**
+ * @brief UdpClient or MultiLinkDevice Tx trace of a station, once per generated packet
+ */
+void CountTx(StationStats *stats, uint32_t station, Ptr<const Packet> packet)
+{
+	stats->txPackets[station]++;
+}
+
+/**
+ * @brief UdpServer RxWithAddresses trace of an AP, the sender is found from its IPv4 address
+ *
+ * param stationOfAddress station id of every STA address
+ *
+ */
+void UdpRx(StationStats *stats, const std::unordered_map<uint32_t, uint32_t> *stationOfAddress,
+	   Ptr<const Packet> packet, const Address &from, const Address &to)
+{
+	std::unordered_map<uint32_t, uint32_t>::const_iterator it =
+		stationOfAddress->find(InetSocketAddress::ConvertFrom(from).GetIpv4().Get());
+	if(it == stationOfAddress->end())
+	{
+		return;
+	}
+	/* UdpClient puts the generation time in a SeqTsHeader */
+	SeqTsHeader seqTs;
+	packet->Copy()->RemoveHeader(seqTs);
+	CountRx(stats, it->second, packet->GetSize(), Simulator::Now() - seqTs.GetTs());
+}
+
+/**
+ * @brief MultiLinkDevice Rx trace of an AP MLD, the sender is found from the node id in its MLD sequence tag
+ *
+ * param stationOfNode station id of every node, indexed by node id
+ *
+ */
+void MldRx(StationStats *stats, const std::vector<uint32_t> *stationOfNode, Ptr<const Packet> packet, Time latency)
+{
+	MldSequenceTag tag;
+	if(!packet->PeekPacketTag(tag) || tag.GetSource() >= stationOfNode->size())
+	{
+		return;
+	}
+	CountRx(stats, (*stationOfNode)[tag.GetSource()], packet->GetSize(), latency);
+}
+
+/**
+ * @brief Jain's fairness index (sum x)^2 / (n sum x^2), 1 when every station gets the same share
+ */
+double JainIndex(const std::vector<double> &x)
+{
+	double sum = 0;
+	double sumSquares = 0;
+	for(uint32_t i = 0; i < x.size(); i++)
+	{
+		sum += x[i];
+		sumSquares += x[i] * x[i];
+	}
+	return (sumSquares > 0)? sum * sum / (x.size() * sumSquares) : 1.0;
+}
+
+/**
+ * @brief nBss overlapping BSSs of nStaPerBss STAs (or STA MLDs) sending CBR uplink traffic to their AP
+ *
+ * Every BSS has its own SSID and AP; all of them share the same channel (channels 36 and 48 for
+ * the two links of MLDs), so the STAs of every BSS contend with each other. STAs are spread on a
+ * disc of bssRadius around their AP, and APs are bssSpacing apart on a line.
+ */
+int main(int argc, char *argv[])
+{
+	/* topology parameters */
+	uint32_t nBss = 1;
+	uint32_t nStaPerBss = 10;
+	bool useMld = false;			/* STA MLDs in direct mode instead of single-link STAs */
+	double bssRadius = 10.0;		/* meters */
+	double bssSpacing = 30.0;		/* meters between neighbouring APs */
+
+	/* traffic parameters */
+	std::string cbrRate = "1Mb/s";		/* uplink traffic of every station */
+	uint32_t packetSize = 1024;		/* UDP payload, MLDs always send 1024 bytes */
+	double startTime = 1.0;			/* stations start sending, once associated */
+	double simulationTime = 5.0;		/* measured duration */
+
+	/* eMLSR parameters */
+	uint32_t transitFreq = 100;		/* ms */
+	uint32_t transitDelay = 128;		/* us */
+
+	std::string perStationFile = "";	/* per-station statistics in CSV, none if empty */
+
+	CommandLine cmd;
+	cmd.AddValue("nBss", "Number of overlapping BSSs", nBss);
+	cmd.AddValue("nStaPerBss", "Number of STAs (or STA MLDs) per BSS", nStaPerBss);
+	cmd.AddValue("useMld", "Use STA MLDs in direct mode instead of single-link STAs", useMld);
+	cmd.AddValue("bssRadius", "Radius of the disc of the STAs around their AP (m)", bssRadius);
+	cmd.AddValue("bssSpacing", "Distance between neighbouring APs (m)", bssSpacing);
+	cmd.AddValue("cbrRate", "CBR uplink rate of every station", cbrRate);
+	cmd.AddValue("packetSize", "UDP payload of single-link STAs (bytes)", packetSize);
+	cmd.AddValue("simulationTime", "Measured duration (s)", simulationTime);
+	cmd.AddValue("transitFreq", "eMLSR link switching period of STA MLDs (ms)", transitFreq);
+	cmd.AddValue("transitDelay", "eMLSR link transition delay of STA MLDs (us)", transitDelay);
+	cmd.AddValue("perStationFile", "Write per-station statistics to this CSV file", perStationFile);
+	cmd.Parse(argc, argv);
+
+	NS_ABORT_MSG_IF(!useMld && nBss > 254, "Every BSS takes a 10.x.0.0/16 subnet, at most 254 BSSs");
+	if(useMld)
+	{
+		packetSize = 1024;
+	}
+	uint32_t nStations = nBss * nStaPerBss;
+	std::chrono::steady_clock::time_point setupStart = std::chrono::steady_clock::now();
+
+	/* create nodes: one node per AP/STA, holding both links of an MLD */
+	NodeContainer apNodes;
+	apNodes.Create(nBss);
+	std::vector<NodeContainer> staNodes(nBss);
+	for(uint32_t bss = 0; bss < nBss; bss++)
+	{
+		staNodes[bss].Create(nStaPerBss);
+	}
+
+	/* create mobility model */
+	MobilityHelper mobility;
+	mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+	Ptr<ListPositionAllocator> apPositions = CreateObject<ListPositionAllocator>();
+	for(uint32_t bss = 0; bss < nBss; bss++)
+	{
+		apPositions->Add(Vector(bss * bssSpacing, 0, 0));
+	}
+	mobility.SetPositionAllocator(apPositions);
+	mobility.Install(apNodes);
+	for(uint32_t bss = 0; bss < nBss; bss++)
+	{
+		std::ostringstream rho;
+		rho << "ns3::UniformRandomVariable[Min=0|Max=" << bssRadius << "]";
+		mobility.SetPositionAllocator("ns3::RandomDiscPositionAllocator",
+					      "X", DoubleValue(bss * bssSpacing),
+					      "Y", DoubleValue(0),
+					      "Rho", StringValue(rho.str()));
+		mobility.Install(staNodes[bss]);
+	}
+
+	/* create wifi helper */
+	WifiHelper wifi;
+	wifi.SetStandard(WIFI_STANDARD_80211ax_5GHZ);
+	wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+				     "DataMode", StringValue("HeMcs7"),
+				     "ControlMode", StringValue("HeMcs0"));
+
+	/* every BSS shares the channel of each link */
+	YansWifiChannelHelper channelHelper = YansWifiChannelHelper::Default();
+	Ptr<YansWifiChannel> channel1 = channelHelper.Create();
+	Ptr<YansWifiChannel> channel2 = channelHelper.Create();
+
+	StationStats stats;
+	stats.Resize(nStations);
+	std::unordered_map<uint32_t, uint32_t> stationOfAddress;	/* single-link STAs: IPv4 address -> station id */
+	std::vector<uint32_t> stationOfNode;				/* STA MLDs: node id -> station id */
+	std::vector<Ptr<MultiLinkDevice> > apMlds;
+	Ptr<UniformRandomVariable> startJitter = CreateObject<UniformRandomVariable>();
+	Time interval = Seconds(packetSize * 8 / static_cast<double>(DataRate(cbrRate).GetBitRate()));
+
+	if(useMld)
+	{
+		stationOfNode.assign(NodeList::GetNNodes(), nStations);
+		for(uint32_t bss = 0; bss < nBss; bss++)
+		{
+			std::ostringstream name;
+			name << "dense-" << bss;
+			std::vector<Ptr<MultiLinkDevice> > mlds = MultiLinkDeviceHelper::InstallMlds(wifi, channel1, channel2, name.str(),
+												       apNodes.Get(bss), staNodes[bss]);
+			mlds[0]->TraceConnectWithoutContext("Rx", MakeBoundCallback(&MldRx, &stats, &stationOfNode));
+			apMlds.push_back(mlds[0]);
+			for(uint32_t sta = 0; sta < nStaPerBss; sta++)
+			{
+				uint32_t station = bss * nStaPerBss + sta;
+				Ptr<MultiLinkDevice> mld = mlds[sta + 1];
+				mld->SetTransitFreq(MilliSeconds(transitFreq));
+				mld->SetTransitDelay(MicroSeconds(transitDelay));
+				mld->TraceConnectWithoutContext("Tx", MakeBoundCallback(&CountTx, &stats, station));
+				stationOfNode[staNodes[bss].Get(sta)->GetId()] = station;
+			}
+			/* spread the starts over one packet interval, so that stations do not send in lockstep */
+			MultiLinkDeviceHelper::StartDirect(mlds, DataRate(cbrRate), Seconds(startTime), interval);
+		}
+	}
+	else
+	{
+		/* create Internet stack */
+		InternetStackHelper stack;
+		stack.Install(apNodes);
+		MultiLinkDeviceHelper mldHelper;
+		uint32_t port = 77;
+		for(uint32_t bss = 0; bss < nBss; bss++)
+		{
+			std::ostringstream name;
+			name << "dense-" << bss;
+			NodeContainer apNode(apNodes.Get(bss));
+			NetDeviceContainer apDevices = MultiLinkDeviceHelper::InstallLink(wifi, channel1, 36, 5180, Ssid(name.str()), true, apNode);
+			NetDeviceContainer staDevices = MultiLinkDeviceHelper::InstallLink(wifi, channel1, 36, 5180, Ssid(name.str()), false, staNodes[bss]);
+			stack.Install(staNodes[bss]);
+
+			/* one /16 per BSS, hundreds of STAs fit in it */
+			std::ostringstream base;
+			base << "10." << bss + 1 << ".0.0";
+			Ipv4AddressHelper ipv4;
+			ipv4.SetBase(base.str().c_str(), "255.255.0.0");
+			Ipv4InterfaceContainer apAddr;
+			Ipv4InterfaceContainer staAddr;
+			mldHelper.AssignStar(ipv4, apDevices, staDevices, apAddr, staAddr);
+
+			UdpServerHelper udpServer(port);
+			ApplicationContainer serverApp = udpServer.Install(apNode);
+			serverApp.Start(Seconds(0.0));
+			serverApp.Get(0)->TraceConnectWithoutContext("RxWithAddresses", MakeBoundCallback(&UdpRx, &stats, &stationOfAddress));
+
+			UdpClientHelper udpClient(apAddr.GetAddress(0), port);
+			udpClient.SetAttribute("MaxPackets", UintegerValue(0));
+			udpClient.SetAttribute("Interval", TimeValue(interval));
+			udpClient.SetAttribute("PacketSize", UintegerValue(packetSize));
+			for(uint32_t sta = 0; sta < nStaPerBss; sta++)
+			{
+				uint32_t station = bss * nStaPerBss + sta;
+				ApplicationContainer clientApp = udpClient.Install(staNodes[bss].Get(sta));
+				/* spread the starts over one packet interval, so that stations do not send in lockstep */
+				clientApp.Start(Seconds(startTime + interval.GetSeconds() * startJitter->GetValue()));
+				clientApp.Get(0)->TraceConnectWithoutContext("Tx", MakeBoundCallback(&CountTx, &stats, station));
+				stationOfAddress[staAddr.GetAddress(sta).Get()] = station;
+			}
+		}
+	}
+
+	/* start simulation */
+	std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+	Simulator::Stop(Seconds(startTime + simulationTime));
+	Simulator::Run();
+	std::chrono::steady_clock::time_point runEnd = std::chrono::steady_clock::now();
+
+	uint32_t duplicates = 0;
+	for(uint32_t i = 0; i < apMlds.size(); i++)
+	{
+		duplicates += apMlds[i]->GetDuplicates();
+	}
+
+	/* aggregate and per-station results, walking the arrays once */
+	std::vector<double> throughput(nStations);	/* Mbit/s */
+	uint64_t totalTx = 0;
+	uint64_t totalRx = 0;
+	uint64_t totalRxBytes = 0;
+	int64_t totalLatency = 0;
+	int64_t worstLatency = 0;
+	uint32_t starved = 0;
+	double minThroughput = (nStations > 0)? -1 : 0;
+	double maxThroughput = 0;
+	for(uint32_t i = 0; i < nStations; i++)
+	{
+		throughput[i] = stats.rxBytes[i] * 8.0 / (1e6 * simulationTime);
+		totalTx += stats.txPackets[i];
+		totalRx += stats.rxPackets[i];
+		totalRxBytes += stats.rxBytes[i];
+		totalLatency += stats.latencySum[i];
+		worstLatency = std::max(worstLatency, stats.latencyMax[i]);
+		if(stats.rxPackets[i] == 0)
+		{
+			starved++;
+		}
+		if(minThroughput < 0 || throughput[i] < minThroughput)
+		{
+			minThroughput = throughput[i];
+		}
+		maxThroughput = std::max(maxThroughput, throughput[i]);
+	}
+	double aggregate = totalRxBytes * 8.0 / (1e6 * simulationTime);
+	double setupSeconds = std::chrono::duration<double>(runStart - setupStart).count();
+	double runSeconds = std::chrono::duration<double>(runEnd - runStart).count();
+	uint64_t events = Simulator::GetEventCount();
+
+	std::cout << "BSSs: " << nBss << ", " << (useMld? "STA MLDs" : "STAs") << " per BSS: " << nStaPerBss
+		  << ", offered load: " << nStations * DataRate(cbrRate).GetBitRate() / 1e6 << " Mbit/s" << std::endl;
+	std::cout << "Aggregate throughput: " << aggregate << " Mbit/s, delivered " << totalRx << "/" << totalTx
+		  << " packets (" << ((totalTx > 0)? 100.0 * totalRx / totalTx : 0) << "%)";
+	if(useMld)
+	{
+		std::cout << ", duplicates: " << duplicates;
+	}
+	std::cout << std::endl;
+	std::cout << "Latency: mean " << ((totalRx > 0)? totalLatency / 1e6 / totalRx : 0) << " ms, worst "
+		  << worstLatency / 1e6 << " ms" << std::endl;
+	std::cout << "Per-station throughput: min " << minThroughput << ", mean " << ((nStations > 0)? aggregate / nStations : 0)
+		  << ", max " << maxThroughput << " Mbit/s, starved: " << starved << std::endl;
+	std::cout << "Jain's fairness index: " << JainIndex(throughput) << std::endl;
+	std::cout << "Setup: " << setupSeconds << " s, run: " << runSeconds << " s (wall clock), events: " << events
+		  << " (" << events / runSeconds << " events/s)" << std::endl;
+
+	if(!perStationFile.empty())
+	{
+		std::ofstream file(perStationFile.c_str());
+		file << "station,bss,txPackets,rxPackets,throughputMbps,meanLatencyMs,maxLatencyMs" << std::endl;
+		for(uint32_t i = 0; i < nStations; i++)
+		{
+			file << i << "," << i / nStaPerBss << "," << stats.txPackets[i] << "," << stats.rxPackets[i] << ","
+			     << throughput[i] << "," << ((stats.rxPackets[i] > 0)? stats.latencySum[i] / 1e6 / stats.rxPackets[i] : 0) << ","
+			     << stats.latencyMax[i] / 1e6 << std::endl;
+		}
+	}
+
+	Simulator::Destroy();
+	return 0;
+}
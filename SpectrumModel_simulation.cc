@@ -10,6 +10,11 @@
 #include "ns3/packet-sink.h"
 #include "ns3/spectrum-analyzer-helper.h"
 #include "ns3/wifi-spectrum-value-helper.h"
+#include "ns3/spectrum-occupancy-sink.h"
+#include "ns3/lookup-error-rate-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-tx-vector.h"
+#include "ns3/cached-propagation-model.h"
 #include "ns3/uinteger.h"
 #include "ns3/string.h"
 #include "ns3/double.h"
@@ -44,6 +49,13 @@ int main()
 	uint32_t simulationOffset = 50 * 1000;		/* micro seconds */
 	bool calculateThroughputOrNot = true;
 	uint32_t analyzerResolution = 80;		/* every 40 micro seconds analyze spectrum one time */
+	bool dumpPsd = false;				/* write every raw PSD sample in ASCII or not */
+	double occupancyThreshold = -62.0;		/* energy (dBm) above which a channel is considered busy */
+	std::string occupancyFile = "spectrum-occupancy.txt";	/* occupancy summary output */
+	bool lookupErrorRate = false;			/* use table driven error rates instead of evaluating NistErrorRateModel */
+	bool errorRateAccuracyCheck = false;		/* compare every lookup against NistErrorRateModel */
+	std::string errorRateCache = "";		/* file the tables are reused from across runs, empty to build them every run */
+	bool cachePropagation = true;			/* cache loss/delay between static nodes */
 	bool verbose = false;
 	
 	if(verbose)
@@ -52,6 +64,7 @@ int main()
 		//LogComponentEnable("OnOffApplication", LOG_LEVEL_INFO);
 		LogComponentEnable("SpectrumWifiPhy", LOG_LEVEL_INFO);
 		//LogComponentEnable("WifiSpectrumValueHelper", LOG_LEVEL_ALL);
+		LogComponentEnable("LookupErrorRateModel", LOG_LEVEL_INFO);
 	}
 
 	/* create nodes */
@@ -63,11 +76,30 @@ int main()
 	spectrumAnalyzerNodes.Create(1);
 
 	/* create spectrum channel */
-	SpectrumChannelHelper channelHelper = SpectrumChannelHelper::Default();
+	SpectrumChannelHelper channelHelper;
 	channelHelper.SetChannel("ns3::MultiModelSpectrumChannel");
 	channelHelper.AddSpectrumPropagationLoss("ns3::ConstantSpectrumPropagationLossModel");
 	Ptr<SpectrumChannel> channel = channelHelper.Create(); 
 
+	/* same loss/delay models as SpectrumChannelHelper::Default(), every node is static so
+	 * the loss/delay of every (transmitter, receiver) pair can be computed once */
+	Ptr<CachedPropagationLossModel> cachedLoss;
+	Ptr<CachedPropagationDelayModel> cachedDelay;
+	if(cachePropagation)
+	{
+		cachedLoss = CreateObject<CachedPropagationLossModel>();
+		cachedLoss->SetModel(CreateObject<FriisPropagationLossModel>());
+		cachedDelay = CreateObject<CachedPropagationDelayModel>();
+		cachedDelay->SetModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+		channel->AddPropagationLossModel(cachedLoss);
+		channel->SetPropagationDelayModel(cachedDelay);
+	}
+	else
+	{
+		channel->AddPropagationLossModel(CreateObject<FriisPropagationLossModel>());
+		channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+	}
+
 	/* create wifi helper */
 	WifiHelper wifi;
 	wifi.SetStandard(WIFI_STANDARD_80211ax_5GHZ);
@@ -137,6 +169,27 @@ int main()
 	apDevice2 = wifi.Install(spectrumPhy2, mac2, apNodes.Get(1));
 
 
+	/* share one table driven error rate model among all PHYs so that every table is built once */
+	Ptr<LookupErrorRateModel> lookupModel;
+	if(lookupErrorRate)
+	{
+		lookupModel = CreateObject<LookupErrorRateModel>();
+		lookupModel->SetAttribute("CacheFile", StringValue(errorRateCache));
+		lookupModel->SetAttribute("AccuracyCheck", BooleanValue(errorRateAccuracyCheck));
+		/* data frames use HeMcs0, other modes (preamble fields) are built on first use */
+		WifiTxVector dataTxVector;
+		dataTxVector.SetMode(WifiMode("HeMcs0"));
+		dataTxVector.SetChannelWidth(bandwidth1);
+		lookupModel->Precompute(WifiMode("HeMcs0"), dataTxVector);
+		NetDeviceContainer wifiDevices(staDevice1, apDevice1);
+		wifiDevices.Add(staDevice2);
+		wifiDevices.Add(apDevice2);
+		for(uint32_t i = 0; i < wifiDevices.GetN(); i++)
+		{
+			DynamicCast<WifiNetDevice>(wifiDevices.Get(i))->GetPhy()->SetErrorRateModel(lookupModel);
+		}
+	}
+
 	/* mobility setting */
 	MobilityHelper mobility;
 	mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
@@ -224,8 +277,22 @@ int main()
 	spectrumAnalyzerHelper.SetChannel(channel);
 	spectrumAnalyzerHelper.SetRxSpectrumModel(spectrumAnalyzerFreqModel);
 	spectrumAnalyzerHelper.SetPhyAttribute("Resolution", TimeValue(MicroSeconds(analyzerResolution)));
-	spectrumAnalyzerHelper.EnableAsciiAll("TEST000");
+	if(dumpPsd)
+	{
+		spectrumAnalyzerHelper.EnableAsciiAll("TEST000");
+	}
 	spectrumAnalyzerDevice = spectrumAnalyzerHelper.Install(spectrumAnalyzerNodes);
+
+	/* reduce every PSD sample into per-channel occupancy counters while simulating */
+	Ptr<SpectrumOccupancySink> occupancySink = CreateObject<SpectrumOccupancySink>();
+	occupancySink->SetThreshold(occupancyThreshold);
+	uint32_t bss1 = occupancySink->AddSubband("BSS1_" + std::to_string(frequency1),
+						 (frequency1 - bandwidth1 / 2) * 1e6,
+						 (frequency1 + bandwidth1 / 2) * 1e6);
+	uint32_t bss2 = occupancySink->AddSubband("BSS2_" + std::to_string(frequency2),
+						 (frequency2 - bandwidth2 / 2) * 1e6,
+						 (frequency2 + bandwidth2 / 2) * 1e6);
+	occupancySink->ConnectToAnalyzer(spectrumAnalyzerDevice.Get(0));
 	
 
 	/* start simulation */
@@ -241,6 +308,32 @@ int main()
 	double averageThroughput2 = ((sink2->GetTotalRx() * 8) / (double)(simulationDurationTime));
 	std::cout << "\nAverage Throughput\nAP 1\tAP 2\n" << averageThroughput1 << "\t" << averageThroughput2 << std::endl;
 
+	/* print spectrum occupancy */
+	std::cout << "\nDuty Cycle\nBSS 1\tBSS 2\tOverlap\n" << occupancySink->GetDutyCycle(bss1) << "\t"
+		  << occupancySink->GetDutyCycle(bss2) << "\t" << occupancySink->GetOverlap(bss1, bss2) << std::endl;
+	occupancySink->WriteSummary(occupancyFile);
+
+	if(cachePropagation)
+	{
+		std::cout << "\nPropagation Cache\nLoss hits\tLoss misses\tDelay hits\tDelay misses\tInvalidations\n"
+			  << cachedLoss->GetHits() << "\t" << cachedLoss->GetMisses() << "\t"
+			  << cachedDelay->GetHits() << "\t" << cachedDelay->GetMisses() << "\t"
+			  << cachedLoss->GetInvalidations() << std::endl;
+	}
+
+	if(lookupErrorRate)
+	{
+		if(errorRateAccuracyCheck)
+		{
+			std::cout << "\nError Rate Lookup Accuracy\nChecks\tMax error\tMean error\n" << lookupModel->GetNChecks() << "\t"
+				  << lookupModel->GetMaxAbsError() << "\t" << lookupModel->GetMeanAbsError() << std::endl;
+		}
+		if(!errorRateCache.empty())
+		{
+			lookupModel->SaveCache();
+		}
+	}
+
 	Simulator::Destroy();
 
 	return 0;
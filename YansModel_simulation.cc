@@ -10,6 +10,7 @@
 #include "ns3/node-container.h"
 #include "ns3/boolean.h"
 #include "ns3/string.h"
+#include "ns3/multi-link-device-helper.h"
 
 using namespace ns3;
 
@@ -27,13 +28,20 @@ void CalculateThroughput()
 }
 
 /** 
- * @brief use specific WiFi standard and PHY rate to run simulation, and calculating the throughput/delay 
+ * @brief use specific WiFi standard and PHY rates to run simulation, and calculating the throughput/delay 
  * 
+ * The topology is built once per call. Every PHY rate after the first one reuses it:
+ * the new MCS is applied to ConstantRateWifiManager, MAC queues are flushed and the Block
+ * Ack agreements torn down, traffic is left to settle and the sink counter is re-based
+ * before measuring the next point.
+ * ns-3 cannot rewind the clock without Simulator::Destroy, so every point is measured
+ * over its own window instead.
+ *
  * param standard which WiFi standard the simulation will use
- * param phyRate which MCS the WiFi PHY will use (1 spatial stream)
+ * param phyRates which MCSs the WiFi PHY will use (1 spatial stream), one point per MCS
  *
  */
-void RunSimulation(std::string standard, std::string phyRate)
+void RunSimulation(std::string standard, std::vector<std::string> phyRates)
 {
 	/* log or not */
 	bool verbose = true;				/* log or not */
@@ -48,6 +56,10 @@ void RunSimulation(std::string standard, std::string phyRate)
 	uint32_t port = 77;
 	uint32_t packetSize = 1024;	/* size of application layer packets (min = 12 bytes) */
 	double simulationTime = 10.0;		/* simulation duration */
+	double settleTime = 0.5;		/* run time after an MCS change before measuring the next point */
+	
+	/* L3 setting */
+	bool useGlobalRouting = false;	/* populate routes with global routing instead of the star setup */
 	
 	/* use which application */
 	bool udpClientServer = false;	/* use udp-client-server-helper => can trace delay */
@@ -147,7 +159,7 @@ void RunSimulation(std::string standard, std::string phyRate)
 	}
 
 	wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
-				     "DataMode", StringValue(phyRate),
+				     "DataMode", StringValue(phyRates[0]),
 				     "ControlMode", StringValue(controlPhyRate));
 	
 	/* create wifi mac */
@@ -182,8 +194,17 @@ void RunSimulation(std::string standard, std::string phyRate)
 	
 	Ipv4InterfaceContainer staAddr;
 	Ipv4InterfaceContainer apAddr;
-	staAddr = ipv4.Assign(staDevices);
-	apAddr = ipv4.Assign(apDevices);
+	MultiLinkDeviceHelper mldHelper;
+	if(useGlobalRouting == true)
+	{
+		staAddr = ipv4.Assign(staDevices);
+		apAddr = ipv4.Assign(apDevices);
+	}
+	else
+	{
+		/* single-hop BSS: addresses, on-link routes and static ARP entries in one pass */
+		mldHelper.AssignStar(ipv4, apDevices, staDevices, apAddr, staAddr);
+	}
 
 	/* use UDP client/server => can use packet timestamp to trace delay */
 	if(udpClientServer == true)
@@ -238,23 +259,51 @@ void RunSimulation(std::string standard, std::string phyRate)
 	
 	
 	/* Ipv4 routing table */
-	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	if(useGlobalRouting == true)
+	{
+		Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	}
 	
 	/* start simulation */
 	if(onOffApplication == true && calculateThroughputPerSecond == true)
 	{
 		Simulator::Schedule(Seconds(1.1), &CalculateThroughput);
 	}
-	Simulator::Stop(Seconds(simulationTime + 1));
-	Simulator::Run();
-	
-
-	/* calculate throughput */
-	if(onOffApplication == true)
+	for(uint32_t point = 0; point < phyRates.size(); point++)
 	{
-		double averageThroughput = ((sink->GetTotalRx() * 8) / (1e6 * simulationTime));
-		std::cout  << standard << "\t\t" << phyRate << "\t\t\t";
-		std::cout  << averageThroughput << std::endl;
+		std::string phyRate = phyRates[point];
+		double baseTotalRx = 0;
+		if(point == 0)
+		{
+			Simulator::Stop(Seconds(simulationTime + 1));
+		}
+		else
+		{
+			/* reuse the topology: apply the new MCS and drop frames queued at the old one */
+			Config::Set("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/RemoteStationManager/$ns3::ConstantRateWifiManager/DataMode",
+				    StringValue(phyRate));
+			MultiLinkDeviceHelper::ResetLinks(staDevices, apDevices);
+			MultiLinkDeviceHelper::ResetLinks(apDevices, staDevices);
+			Simulator::Stop(Seconds(settleTime));
+			Simulator::Run();
+
+			/* reset the sink counter of this point */
+			if(onOffApplication == true)
+			{
+				baseTotalRx = sink->GetTotalRx();
+				lastTotalRx = baseTotalRx;
+			}
+			Simulator::Stop(Seconds(simulationTime));
+		}
+		Simulator::Run();
+
+		/* calculate throughput */
+		if(onOffApplication == true)
+		{
+			double averageThroughput = (((sink->GetTotalRx() - baseTotalRx) * 8) / (1e6 * simulationTime));
+			std::cout  << standard << "\t\t" << phyRate << "\t\t\t";
+			std::cout  << averageThroughput << std::endl;
+		}
 	}
 
 	Simulator::Destroy();
@@ -302,37 +351,49 @@ int main()
 		"HeMcs6", "HeMcs7", "HeMcs8", "HeMcs9", "HeMcs10", "HeMcs11"
 	};
 	
+	/* build the topology once per standard and sweep the MCSs on it */
+	bool sweepReuse = true;
+
 	std::cout << "WiFi Standard\t" << "MCS\t";
 	std::cout << "Average throughput (Mbits/s)" << std::endl;
 	
 	uint8_t j;
 	/* 20MHz bandwidth, 5GHz simulation */
-	for(j = 0; j < 8; j++)
-	{
-		RunSimulation(standardList[1], HtMcs[j]);
-	}
-	for(j = 0; j <9; j++)
+	if(sweepReuse)
 	{
-		RunSimulation(standardList[2], VhtMcs[j]);
+		RunSimulation(standardList[1], std::vector<std::string>(HtMcs, HtMcs + 8));
+		RunSimulation(standardList[2], std::vector<std::string>(VhtMcs, VhtMcs + 9));
+		RunSimulation(standardList[4], std::vector<std::string>(HeMcs, HeMcs + 12));
 	}
-	for(j = 0; j < 12; j++)
+	else
 	{
-		RunSimulation(standardList[4], HeMcs[j]);
+		for(j = 0; j < 8; j++)
+		{
+			RunSimulation(standardList[1], std::vector<std::string>(1, HtMcs[j]));
+		}
+		for(j = 0; j <9; j++)
+		{
+			RunSimulation(standardList[2], std::vector<std::string>(1, VhtMcs[j]));
+		}
+		for(j = 0; j < 12; j++)
+		{
+			RunSimulation(standardList[4], std::vector<std::string>(1, HeMcs[j]));
+		}
 	}
 	
 	/* 40MHz bandwidth, 2.4GHz simulation */
 	/*
 	for(j = 0; j < 8; j++)
 	{
-		RunSimulation(standardList[0], HtMcs[j]);
+		RunSimulation(standardList[0], std::vector<std::string>(1, HtMcs[j]));
 	}
 	for(j = 0; j < 12; j++)
 	{
-		RunSimulation(standardList[3], HeMcs[j]);
+		RunSimulation(standardList[3], std::vector<std::string>(1, HeMcs[j]));
 	}
 	for(j = 0; j < 12; j++)
 	{
-		RunSimulation(standardList[5], HeMcs[j]);
+		RunSimulation(standardList[5], std::vector<std::string>(1, HeMcs[j]));
 	}
 	*/
 	
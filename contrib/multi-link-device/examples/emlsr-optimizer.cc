@@ -0,0 +1,253 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Search of the eMLSR transition frequency (MultiLinkDevice::SetTransitFreq)
+ * maximizing the throughput delivered to the AP MLD, or minimizing the p99
+ * latency of its packets, for a given load.
+ *
+ * Every trial runs the reference MLD scenario of mld-benchmark
+ * (MultiLinkDeviceHelper::InstallReferenceScenario, nMld STA MLDs in direct
+ * mode) at one transition frequency. The search is a golden-section search
+ * over log(transitFreq), so each iteration costs one trial. A trial is stopped early, after minTrialTime, once its objective is
+ * worse than the best trial so far by more than stopMargin; it then loses
+ * every comparison of the search (infinite cost). Every sampled
+ * point is written to emlsr-optimizer.csv (the response curve).
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/multi-link-device-helper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <vector>
+
+using namespace ns3;
+
+/* outcome of the trial of one transition frequency */
+struct TrialResult
+{
+  double transitFreq;   /* ms */
+  double throughput;    /* Mbit/s */
+  double p99Latency;    /* ms */
+  double cost;          /* objective to minimize */
+  double simulated;     /* measured time (s) */
+  bool stopped;         /* stopped early */
+};
+
+/* cost of a trial in the search: a stopped trial only shows it is worse than the best one,
+   its partial cost must not win a comparison */
+double
+SearchCost (const TrialResult &trial)
+{
+  return trial.stopped ? std::numeric_limits<double>::infinity () : trial.cost;
+}
+
+std::vector<double> g_latencies;        /* latencies (ms) of the packets received in the measurement */
+bool g_measuring = false;
+
+void
+RxLatency (Ptr<const Packet> packet, Time latency)
+{
+  if (g_measuring)
+    {
+      g_latencies.push_back (latency.GetSeconds () * 1e3);
+    }
+}
+
+double
+Percentile (std::vector<double> values, double p)
+{
+  if (values.empty ())
+    {
+      return std::numeric_limits<double>::infinity ();
+    }
+  size_t k = std::min (values.size () - 1, static_cast<size_t> (std::ceil (p * values.size ())) - 1);
+  std::nth_element (values.begin (), values.begin () + k, values.end ());
+  return values[k];
+}
+
+class EmlsrOptimizer
+{
+public:
+  uint32_t nMld = 10;
+  std::string cbrRate = "5Mb/s";
+  uint32_t transitDelay = 128;          /* us */
+  bool minimizeLatency = false;
+  double startTime = 1.0;               /* STA MLDs start sending, once associated */
+  double warmupTime = 0.5;              /* traffic before measuring */
+  double trialTime = 5.0;               /* measured time of a full trial */
+  double minTrialTime = 2.0;            /* measured time before a trial can be stopped */
+  double checkInterval = 0.5;           /* time between early stopping checks */
+  double stopMargin = 0.1;              /* relative margin to the best cost to stop a trial */
+
+  /* run a trial, or return the one already run at this frequency */
+  TrialResult Evaluate (double transitFreq);
+  /* get every trial run, by frequency */
+  std::vector<TrialResult> GetTrials (void);
+
+private:
+  /* cost of the packets received so far */
+  double GetCost (double throughput, double p99Latency);
+
+  std::map<double, TrialResult> m_trials;
+  double m_bestCost = std::numeric_limits<double>::infinity ();
+};
+
+double
+EmlsrOptimizer::GetCost (double throughput, double p99Latency)
+{
+  return minimizeLatency ? p99Latency : -throughput;
+}
+
+TrialResult
+EmlsrOptimizer::Evaluate (double transitFreq)
+{
+  std::map<double, TrialResult>::iterator it = m_trials.find (transitFreq);
+  if (it != m_trials.end ())
+    {
+      return it->second;
+    }
+
+  std::vector<Ptr<MultiLinkDevice> > mlds =
+    MultiLinkDeviceHelper::InstallReferenceScenario (nMld, MicroSeconds (static_cast<int64_t> (transitFreq * 1000)),
+                                                     MicroSeconds (transitDelay));
+  Ptr<MultiLinkDevice> apMld = mlds[0];
+  apMld->TraceConnectWithoutContext ("Rx", MakeCallback (&RxLatency));
+  MultiLinkDeviceHelper::StartDirect (mlds, DataRate (cbrRate), Seconds (startTime), Seconds (0));
+
+  /* warm up, then measure in steps so a poor trial can be stopped early */
+  g_latencies.clear ();
+  g_measuring = false;
+  Simulator::Stop (Seconds (startTime + warmupTime));
+  Simulator::Run ();
+  g_measuring = true;
+  uint32_t baseReceive = apMld->GetTotalReceive ();
+
+  TrialResult result;
+  result.transitFreq = transitFreq;
+  result.stopped = false;
+  double measured = 0;
+  while (measured < trialTime)
+    {
+      double step = std::min (checkInterval, trialTime - measured);
+      Simulator::Stop (Seconds (step));
+      Simulator::Run ();
+      measured += step;
+
+      result.throughput = (apMld->GetTotalReceive () - baseReceive) * apMld->GetPacketSize () * 8.0 / (1e6 * measured);
+      result.p99Latency = Percentile (g_latencies, 0.99);
+      result.cost = GetCost (result.throughput, result.p99Latency);
+      if (measured >= minTrialTime && measured < trialTime
+          && result.cost - m_bestCost > stopMargin * std::fabs (m_bestCost))
+        {
+          result.stopped = true;
+          break;
+        }
+    }
+  result.simulated = measured;
+  Simulator::Destroy ();
+
+  if (!result.stopped)
+    {
+      m_bestCost = std::min (m_bestCost, result.cost);
+    }
+  std::cout << "trial " << m_trials.size () + 1 << ": transitFreq " << transitFreq << " ms, "
+            << result.throughput << " Mbit/s, p99 " << result.p99Latency << " ms"
+            << (result.stopped ? " (stopped at " : " (") << measured << " s)" << std::endl;
+  m_trials[transitFreq] = result;
+  return result;
+}
+
+std::vector<TrialResult>
+EmlsrOptimizer::GetTrials (void)
+{
+  std::vector<TrialResult> trials;
+  for (std::map<double, TrialResult>::iterator it = m_trials.begin (); it != m_trials.end (); ++it)
+    {
+      trials.push_back (it->second);
+    }
+  return trials;
+}
+
+int
+main (int argc, char *argv[])
+{
+  EmlsrOptimizer optimizer;
+  double minFreq = 5;           /* ms */
+  double maxFreq = 500;         /* ms */
+  uint32_t iterations = 8;
+  std::string objective = "throughput";
+  std::string curveFile = "emlsr-optimizer.csv";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("nMld", "Number of STA MLDs", optimizer.nMld);
+  cmd.AddValue ("cbrRate", "CBR rate of every STA MLD", optimizer.cbrRate);
+  cmd.AddValue ("transitDelay", "eMLSR link transition delay (us)", optimizer.transitDelay);
+  cmd.AddValue ("minFreq", "Lowest transition frequency searched (ms)", minFreq);
+  cmd.AddValue ("maxFreq", "Highest transition frequency searched (ms)", maxFreq);
+  cmd.AddValue ("iterations", "Golden-section iterations, one trial each", iterations);
+  cmd.AddValue ("objective", "throughput (maximized) or latency (p99, minimized)", objective);
+  cmd.AddValue ("trialTime", "Measured time of a full trial (s)", optimizer.trialTime);
+  cmd.AddValue ("minTrialTime", "Measured time before a trial can be stopped (s)", optimizer.minTrialTime);
+  cmd.AddValue ("stopMargin", "Relative margin to the best trial to stop a trial", optimizer.stopMargin);
+  cmd.AddValue ("curveFile", "CSV file of the sampled response curve", curveFile);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (objective != "throughput" && objective != "latency", "Unknown objective " << objective);
+  NS_ABORT_MSG_IF (minFreq <= 0 || maxFreq <= minFreq, "Invalid transition frequency range");
+  optimizer.minimizeLatency = (objective == "latency");
+
+  /* golden-section search on log(transitFreq): the response spans decades */
+  const double invPhi = (std::sqrt (5.0) - 1) / 2;
+  double a = std::log (minFreq);
+  double b = std::log (maxFreq);
+  double c = b - invPhi * (b - a);
+  double d = a + invPhi * (b - a);
+  TrialResult rc = optimizer.Evaluate (std::exp (c));
+  TrialResult rd = optimizer.Evaluate (std::exp (d));
+  for (uint32_t i = 0; i < iterations; i++)
+    {
+      if (SearchCost (rc) < SearchCost (rd))
+        {
+          b = d;
+          d = c;
+          rd = rc;
+          c = b - invPhi * (b - a);
+          rc = optimizer.Evaluate (std::exp (c));
+        }
+      else
+        {
+          a = c;
+          c = d;
+          rc = rd;
+          d = a + invPhi * (b - a);
+          rd = optimizer.Evaluate (std::exp (d));
+        }
+    }
+
+  std::vector<TrialResult> trials = optimizer.GetTrials ();
+  TrialResult best = trials[0];
+  double simulated = 0;
+  std::ofstream curve (curveFile.c_str ());
+  curve << "transitFreqMs,throughputMbps,p99LatencyMs,measuredS,stopped" << std::endl;
+  for (uint32_t i = 0; i < trials.size (); i++)
+    {
+      curve << trials[i].transitFreq << "," << trials[i].throughput << "," << trials[i].p99Latency << ","
+            << trials[i].simulated << "," << trials[i].stopped << std::endl;
+      simulated += trials[i].simulated;
+      if (!trials[i].stopped && (best.stopped || trials[i].cost < best.cost))
+        {
+          best = trials[i];
+        }
+    }
+
+  std::cout << "Best transitFreq: " << best.transitFreq << " ms, " << best.throughput << " Mbit/s, p99 "
+            << best.p99Latency << " ms" << std::endl;
+  std::cout << trials.size () << " trials, " << simulated << " s measured in total, response curve in "
+            << curveFile << std::endl;
+  return 0;
+}
@@ -0,0 +1,211 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Reference MLD scenario for benchmarks: an AP MLD and nMld STA MLDs, the two
+ * affiliated links of every MLD on their own 5 GHz channel (36 and 48, Yans).
+ * STA MLDs switch links (eMLSR) and send CBR traffic to the AP MLD in direct
+ * mode. Reports the wall-clock time, the event rate and, with memoryAccounting,
+ * the memory footprint per node, MLD, link device and queued packet. With
+ * capture, both links of every MLD are captured asynchronously into
+ * mld-benchmark.pcapng (one interface per link) and the frames dropped on a
+ * full capture ring are reported, or waited for with captureBackpressure.
+ *
+ * The scenario is run for every scheduler of schedulers and every size of
+ * nMlds, then the event rates are summarized, e.g. to compare the timer wheel
+ * with the stock schedulers:
+ *   --schedulers=ns3::MapScheduler,ns3::HeapScheduler,ns3::CalendarScheduler,ns3::TimerWheelScheduler
+ *   --nMlds=1000,5000,10000 --simulationTime=1
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/multi-link-device-helper.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace ns3;
+
+double simulationTime = 5.0;            /* seconds */
+double startTime = 1.0;                 /* STA MLDs start sending, once associated */
+std::string cbrRate = "1Mb/s";          /* traffic of every STA MLD */
+uint32_t transitFreq = 100;             /* ms */
+uint32_t transitDelay = 128;            /* us */
+bool memoryAccounting = false;
+uint32_t memoryInterval = 100;          /* ms */
+bool capture = false;
+uint32_t snapLen = 128;                 /* bytes kept of every captured frame */
+bool compress = false;
+bool captureBackpressure = false;       /* the simulation waits for the capture instead of dropping frames */
+
+/* wall-clock cost of a run */
+struct BenchmarkResult
+{
+  std::string scheduler;
+  uint32_t nMld;
+  double setupSeconds;
+  double runSeconds;
+  uint64_t events;
+};
+
+/* split a comma separated list */
+std::vector<std::string>
+Split (std::string list)
+{
+  std::vector<std::string> items;
+  std::istringstream stream (list);
+  std::string item;
+  while (std::getline (stream, item, ','))
+    {
+      if (!item.empty ())
+        {
+          items.push_back (item);
+        }
+    }
+  return items;
+}
+
+/* run the reference scenario once */
+BenchmarkResult
+RunBenchmark (uint32_t nMld, std::string scheduler)
+{
+  /* the scheduler is set before anything is scheduled */
+  ObjectFactory factory;
+  factory.SetTypeId (scheduler);
+  Simulator::SetScheduler (factory);
+
+  std::chrono::steady_clock::time_point setupStart = std::chrono::steady_clock::now ();
+
+  std::vector<Ptr<MultiLinkDevice> > mlds = MultiLinkDeviceHelper::InstallReferenceScenario (nMld, MilliSeconds (transitFreq),
+                                                                                             MicroSeconds (transitDelay));
+  Ptr<MultiLinkDevice> apMld = mlds[0];
+  MultiLinkDeviceHelper::StartDirect (mlds, DataRate (cbrRate), Seconds (startTime), Seconds (0));
+
+  MultiLinkDeviceHelper mldHelper;
+  if (memoryAccounting)
+    {
+      mldHelper.EnableMemoryAccounting (mlds, MilliSeconds (memoryInterval));
+    }
+  if (capture)
+    {
+      for (uint32_t i = 0; i < mlds.size (); i++)
+        {
+          mldHelper.EnableAsyncPcap ("mld-benchmark", mlds[i], snapLen, compress);
+        }
+    }
+
+  std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now ();
+  Simulator::Stop (Seconds (startTime + simulationTime));
+  Simulator::Run ();
+  std::chrono::steady_clock::time_point runEnd = std::chrono::steady_clock::now ();
+  /* the remaining frames are written after the measured run */
+  mldHelper.CloseAsyncPcap ();
+
+  double setupSeconds = std::chrono::duration<double> (runStart - setupStart).count ();
+  double runSeconds = std::chrono::duration<double> (runEnd - runStart).count ();
+  uint64_t events = Simulator::GetEventCount ();
+  uint64_t sent = 0;           /* thousands of MLDs overflow 32 bits */
+  uint32_t retransmissions = 0;
+  uint32_t retransmissionsLost = 0;
+  for (uint32_t i = 1; i < mlds.size (); i++)
+    {
+      sent += mlds[i]->GetTotalByte ();
+      retransmissions += mlds[i]->GetRetransmissions ();
+      retransmissionsLost += mlds[i]->GetRetransmissionsLost ();
+    }
+  double throughput = apMld->GetTotalReceive () * apMld->GetPacketSize () * 8.0 / (1e6 * simulationTime);
+
+  std::cout << "Scheduler: " << scheduler << ", STA MLDs: " << nMld << std::endl;
+  std::cout << "Setup: " << setupSeconds << " s, run: " << runSeconds << " s (wall clock)" << std::endl;
+  std::cout << "Events: " << events << ", " << events / runSeconds << " events/s" << std::endl;
+  std::cout << "Sent: " << sent << " bytes, received: " << apMld->GetTotalReceive () << " packets ("
+            << throughput << " Mbit/s), retransmitted: " << retransmissions << " (lost " << retransmissionsLost << ")"
+            << ", duplicates: " << apMld->GetDuplicates () << ", too old: " << apMld->GetTooOld () << std::endl;
+  if (nMld > 0)
+    {
+      /* airtime breakdown of the first STA MLD */
+      for (uint32_t link = 0; link < 2; link++)
+        {
+          std::cout << "Airtime link " << link + 1 << ":";
+          for (uint32_t state = 0; state < MultiLinkDevice::AIRTIME_STATES; state++)
+            {
+              MultiLinkDevice::AirtimeState airtime = static_cast<MultiLinkDevice::AirtimeState> (state);
+              std::cout << " " << MultiLinkDevice::GetAirtimeStateName (airtime) << " "
+                        << mlds[1]->GetAirtime (link, airtime).GetSeconds () << " s";
+            }
+          std::cout << std::endl;
+        }
+    }
+  if (memoryAccounting)
+    {
+      mldHelper.PrintMemoryReport (std::cout);
+    }
+  if (capture)
+    {
+      std::cout << "Capture: " << mldHelper.GetPcapCaptured () << " frames, "
+                << mldHelper.GetPcapDropped () << " dropped" << std::endl;
+    }
+
+  Simulator::Destroy ();
+
+  BenchmarkResult result;
+  result.scheduler = scheduler;
+  result.nMld = nMld;
+  result.setupSeconds = setupSeconds;
+  result.runSeconds = runSeconds;
+  result.events = events;
+  return result;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string nMlds = "10";
+  std::string schedulers = "ns3::MapScheduler";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("nMlds", "Comma separated numbers of STA MLDs", nMlds);
+  cmd.AddValue ("schedulers", "Comma separated scheduler types", schedulers);
+  cmd.AddValue ("simulationTime", "Simulation time (s)", simulationTime);
+  cmd.AddValue ("cbrRate", "CBR rate of every STA MLD", cbrRate);
+  cmd.AddValue ("transitFreq", "eMLSR link switching period (ms)", transitFreq);
+  cmd.AddValue ("transitDelay", "eMLSR link transition delay (us)", transitDelay);
+  cmd.AddValue ("memoryAccounting", "Report the memory footprint of the MLDs", memoryAccounting);
+  cmd.AddValue ("memoryInterval", "Memory sampling interval for the peaks (ms)", memoryInterval);
+  cmd.AddValue ("capture", "Capture both links of every MLD into pcapng files", capture);
+  cmd.AddValue ("snapLen", "Bytes kept of every captured frame", snapLen);
+  cmd.AddValue ("compress", "Gzip the captures", compress);
+  cmd.AddValue ("captureBackpressure", "Wait for the capture instead of dropping frames", captureBackpressure);
+  cmd.Parse (argc, argv);
+  Config::SetDefault ("ns3::MldPcapWriter::Backpressure", BooleanValue (captureBackpressure));
+
+  std::vector<BenchmarkResult> results;
+  std::vector<std::string> sizes = Split (nMlds);
+  std::vector<std::string> types = Split (schedulers);
+  for (uint32_t i = 0; i < sizes.size (); i++)
+    {
+      for (uint32_t j = 0; j < types.size (); j++)
+        {
+          results.push_back (RunBenchmark (std::stoul (sizes[i]), types[j]));
+        }
+    }
+
+  std::cout << std::endl << std::left << std::setw (28) << "scheduler"
+            << std::right << std::setw (8) << "nMld"
+            << std::setw (12) << "setup(s)"
+            << std::setw (12) << "run(s)"
+            << std::setw (14) << "events"
+            << std::setw (14) << "events/s" << std::endl;
+  for (uint32_t i = 0; i < results.size (); i++)
+    {
+      std::cout << std::left << std::setw (28) << results[i].scheduler
+                << std::right << std::setw (8) << results[i].nMld
+                << std::setw (12) << results[i].setupSeconds
+                << std::setw (12) << results[i].runSeconds
+                << std::setw (14) << results[i].events
+                << std::setw (14) << results[i].events / results[i].runSeconds << std::endl;
+    }
+  return 0;
+}
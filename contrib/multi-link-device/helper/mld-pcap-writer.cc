@@ -0,0 +1,380 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/mld-pcap-writer.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("MldPcapWriter");
+
+NS_OBJECT_ENSURE_REGISTERED (MldPcapWriter);
+
+/* pcapng block types and options */
+static const uint32_t PCAPNG_SHB = 0x0A0D0D0A;
+static const uint32_t PCAPNG_IDB = 0x00000001;
+static const uint32_t PCAPNG_EPB = 0x00000006;
+static const uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+static const uint16_t PCAPNG_OPT_ENDOFOPT = 0;
+static const uint16_t PCAPNG_OPT_IF_NAME = 2;
+static const uint16_t PCAPNG_OPT_IF_TSRESOL = 9;
+static const uint16_t PCAPNG_OPT_IF_FCSLEN = 13;
+static const uint16_t LINKTYPE_IEEE802_11 = 105;
+
+/* append a value in host byte order, pcapng readers follow the byte-order magic */
+template <typename T>
+static void
+Append(std::vector<uint8_t> &buffer, T value)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+/* append an option, padded to 32 bits */
+static void
+AppendOption(std::vector<uint8_t> &buffer, uint16_t code, const void *value, uint16_t length)
+{
+    Append<uint16_t>(buffer, code);
+    Append<uint16_t>(buffer, length);
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    buffer.insert(buffer.end(), bytes, bytes + length);
+    buffer.resize(buffer.size() + (4 - length % 4) % 4, 0);
+}
+
+TypeId
+MldPcapWriter::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::MldPcapWriter")
+        .SetParent<Object> ()
+        .AddConstructor<MldPcapWriter> ()
+        .AddAttribute ("SnapLen",
+                       "Bytes kept of every frame",
+                       UintegerValue (2048),
+                       MakeUintegerAccessor (&MldPcapWriter::m_snapLen),
+                       MakeUintegerChecker<uint32_t> (1, 65535))
+        .AddAttribute ("QueueSize",
+                       "Frames the ring between the simulation and the writer thread holds",
+                       UintegerValue (4096),
+                       MakeUintegerAccessor (&MldPcapWriter::m_queueSize),
+                       MakeUintegerChecker<uint32_t> (1))
+        .AddAttribute ("Compress",
+                       "Gzip the file (needs the module to be built with zlib)",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&MldPcapWriter::m_compress),
+                       MakeBooleanChecker ())
+        .AddAttribute ("Backpressure",
+                       "Wait for the writer thread when the ring is full instead of dropping frames",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&MldPcapWriter::m_backpressure),
+                       MakeBooleanChecker ());
+
+        return tid;
+}
+
+MldPcapWriter::MldPcapWriter()
+    : m_snapLen (2048),
+      m_queueSize (4096),
+      m_compress (false),
+      m_backpressure (false),
+      m_head (0),
+      m_tail (0),
+      m_stop (false),
+      m_captured (0),
+      m_dropped (0),
+      m_file (0),
+      m_gzFile (0)
+{}
+
+MldPcapWriter::~MldPcapWriter()
+{
+    Close();
+}
+
+void
+MldPcapWriter::DoDispose()
+{
+    Close();
+    Object::DoDispose();
+}
+
+uint32_t
+MldPcapWriter::AddInterface(std::string name)
+{
+    uint32_t interfaceId = m_interfaces.size();
+    m_interfaces.push_back(name);
+    if(m_thread.joinable())
+    {
+        /* the interface block must not be lost: wait for room */
+        Record *record = Reserve(true);
+        size_t slot = record - &m_records[0];
+        record->isInterface = true;
+        record->interfaceId = interfaceId;
+        record->captured = std::min<size_t>(name.size(), m_snapLen);
+        std::memcpy(&m_data[slot * m_snapLen], name.data(), record->captured);
+        Commit();
+    }
+    return interfaceId;
+}
+
+uint32_t
+MldPcapWriter::ConnectLink(Ptr<WifiPhy> phy, std::string name)
+{
+    uint32_t interfaceId = AddInterface(name);
+    phy->TraceConnectWithoutContext("MonitorSnifferTx", MakeBoundCallback(&MldPcapWriter::SniffTx, this, interfaceId));
+    phy->TraceConnectWithoutContext("MonitorSnifferRx", MakeBoundCallback(&MldPcapWriter::SniffRx, this, interfaceId));
+    m_links.push_back(std::make_pair(phy, interfaceId));
+    return interfaceId;
+}
+
+void
+MldPcapWriter::Open(std::string filename)
+{
+    NS_ABORT_MSG_IF (m_thread.joinable(), "Capture already open");
+    m_filename = filename;
+#ifdef HAVE_ZLIB
+    if(m_compress)
+    {
+        m_filename += ".gz";
+        m_gzFile = gzopen(m_filename.c_str(), "wb");
+        NS_ABORT_MSG_IF (m_gzFile == 0, "Cannot open " << m_filename);
+    }
+#else
+    if(m_compress)
+    {
+        NS_LOG_WARN("Built without zlib, " << filename << " is not compressed");
+    }
+#endif
+    if(m_gzFile == 0)
+    {
+        m_file = std::fopen(m_filename.c_str(), "wb");
+        NS_ABORT_MSG_IF (m_file == 0, "Cannot open " << m_filename);
+    }
+
+    /* section header: version 1.0, unknown section length */
+    std::vector<uint8_t> body;
+    Append<uint32_t>(body, PCAPNG_BYTE_ORDER_MAGIC);
+    Append<uint16_t>(body, 1);
+    Append<uint16_t>(body, 0);
+    Append<int64_t>(body, -1);
+    WriteBlock(PCAPNG_SHB, body);
+
+    /* interfaces added so far, the next ones go through the ring */
+    for(uint32_t i = 0; i < m_interfaces.size(); i++)
+    {
+        WriteInterface(m_interfaces[i]);
+    }
+
+    m_records.resize(m_queueSize);
+    m_data.resize(static_cast<size_t>(m_queueSize) * m_snapLen);
+    m_head = 0;
+    m_tail = 0;
+    m_stop = false;
+    m_thread = std::thread(&MldPcapWriter::Run, this);
+}
+
+void
+MldPcapWriter::WriteInterface(const std::string &name)
+{
+    /* nanosecond timestamps, frames carry their FCS */
+    uint8_t tsresol = 9;
+    uint8_t fcslen = 4;
+    std::vector<uint8_t> body;
+    Append<uint16_t>(body, LINKTYPE_IEEE802_11);
+    Append<uint16_t>(body, 0);
+    Append<uint32_t>(body, m_snapLen);
+    AppendOption(body, PCAPNG_OPT_IF_NAME, name.data(), name.size());
+    AppendOption(body, PCAPNG_OPT_IF_TSRESOL, &tsresol, 1);
+    AppendOption(body, PCAPNG_OPT_IF_FCSLEN, &fcslen, 1);
+    AppendOption(body, PCAPNG_OPT_ENDOFOPT, 0, 0);
+    WriteBlock(PCAPNG_IDB, body);
+}
+
+MldPcapWriter::Record *
+MldPcapWriter::Reserve(bool wait)
+{
+    /* only the simulation thread moves the tail */
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    while(tail - m_head.load(std::memory_order_acquire) >= m_queueSize)
+    {
+        if(!wait)
+        {
+            return 0;
+        }
+        std::this_thread::yield();
+    }
+    return &m_records[tail % m_queueSize];
+}
+
+void
+MldPcapWriter::Commit()
+{
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void
+MldPcapWriter::Capture(uint32_t interfaceId, Ptr<const Packet> packet)
+{
+    if(!m_thread.joinable())
+    {
+        return;
+    }
+    Record *record = Reserve(m_backpressure);
+    if(record == 0)
+    {
+        m_dropped++;
+        return;
+    }
+    size_t slot = record - &m_records[0];
+    record->isInterface = false;
+    record->timestamp = Simulator::Now().GetNanoSeconds();
+    record->interfaceId = interfaceId;
+    record->length = packet->GetSize();
+    record->captured = packet->CopyData(&m_data[slot * m_snapLen], m_snapLen);
+    Commit();
+    m_captured++;
+}
+
+void
+MldPcapWriter::SniffTx(MldPcapWriter *writer, uint32_t interfaceId, Ptr<const Packet> packet,
+                       uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu, uint16_t staId)
+{
+    writer->Capture(interfaceId, packet);
+}
+
+void
+MldPcapWriter::SniffRx(MldPcapWriter *writer, uint32_t interfaceId, Ptr<const Packet> packet,
+                       uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu,
+                       SignalNoiseDbm signalNoise, uint16_t staId)
+{
+    writer->Capture(interfaceId, packet);
+}
+
+void
+MldPcapWriter::Run()
+{
+    std::vector<uint8_t> body;
+    while(true)
+    {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        if(head == m_tail.load(std::memory_order_acquire))
+        {
+            /* the tail is read again after the stop flag, so nothing queued before Close is lost */
+            if(m_stop.load(std::memory_order_acquire) && head == m_tail.load(std::memory_order_acquire))
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        size_t slot = head % m_queueSize;
+        const Record &record = m_records[slot];
+        if(record.isInterface)
+        {
+            WriteInterface(std::string(m_data.begin() + slot * m_snapLen, m_data.begin() + slot * m_snapLen + record.captured));
+            m_head.store(head + 1, std::memory_order_release);
+            continue;
+        }
+        body.clear();
+        Append<uint32_t>(body, record.interfaceId);
+        Append<uint32_t>(body, static_cast<uint32_t>(record.timestamp >> 32));
+        Append<uint32_t>(body, static_cast<uint32_t>(record.timestamp));
+        Append<uint32_t>(body, record.captured);
+        Append<uint32_t>(body, record.length);
+        body.insert(body.end(), m_data.begin() + slot * m_snapLen, m_data.begin() + slot * m_snapLen + record.captured);
+        body.resize(body.size() + (4 - record.captured % 4) % 4, 0);
+        WriteBlock(PCAPNG_EPB, body);
+        /* release the slot to the simulation thread */
+        m_head.store(head + 1, std::memory_order_release);
+    }
+}
+
+void
+MldPcapWriter::WriteBlock(uint32_t type, const std::vector<uint8_t> &body)
+{
+    uint32_t length = 12 + body.size();
+    Write(&type, 4);
+    Write(&length, 4);
+    Write(body.data(), body.size());
+    Write(&length, 4);
+}
+
+void
+MldPcapWriter::Write(const void *data, size_t size)
+{
+#ifdef HAVE_ZLIB
+    if(m_gzFile != 0)
+    {
+        gzwrite(static_cast<gzFile>(m_gzFile), data, size);
+        return;
+    }
+#endif
+    std::fwrite(data, 1, size, m_file);
+}
+
+void
+MldPcapWriter::Close()
+{
+    /* the PHYs outlive the writer, they must not call into it anymore */
+    for(uint32_t i = 0; i < m_links.size(); i++)
+    {
+        Ptr<WifiPhy> phy = m_links[i].first;
+        uint32_t interfaceId = m_links[i].second;
+        phy->TraceDisconnectWithoutContext("MonitorSnifferTx", MakeBoundCallback(&MldPcapWriter::SniffTx, this, interfaceId));
+        phy->TraceDisconnectWithoutContext("MonitorSnifferRx", MakeBoundCallback(&MldPcapWriter::SniffRx, this, interfaceId));
+    }
+    m_links.clear();
+    if(!m_thread.joinable())
+    {
+        return;
+    }
+    m_stop.store(true, std::memory_order_release);
+    m_thread.join();
+    NS_LOG_INFO("[Pcap] " << m_filename << ": " << m_captured << " frames, " << m_dropped << " dropped");
+    if(m_dropped > 0)
+    {
+        NS_LOG_WARN("[Pcap] " << m_filename << " misses " << m_dropped << " frames, the ring was full");
+    }
+#ifdef HAVE_ZLIB
+    if(m_gzFile != 0)
+    {
+        gzclose(static_cast<gzFile>(m_gzFile));
+        m_gzFile = 0;
+    }
+#endif
+    if(m_file != 0)
+    {
+        std::fclose(m_file);
+        m_file = 0;
+    }
+}
+
+std::string
+MldPcapWriter::GetFilename()
+{
+    return m_filename;
+}
+
+uint64_t
+MldPcapWriter::GetCaptured()
+{
+    return m_captured;
+}
+
+uint64_t
+MldPcapWriter::GetDropped()
+{
+    return m_dropped;
+}
+
+}   /* ns3 */
@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef MLD_PCAP_WRITER_H
+#define MLD_PCAP_WRITER_H
+
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/wifi-phy.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Asynchronous pcapng capture of the affiliated links of MLDs.
+ *
+ * Every link is an interface (IDB) of one pcapng file, frames are 802.11 with
+ * their FCS (LINKTYPE_IEEE802_11, if_fcslen 4) and nanosecond timestamps. The
+ * simulation thread only copies the first SnapLen bytes of a frame into a
+ * single-producer/single-consumer ring; a background thread formats the blocks
+ * and writes them, gzip compressed when the module is built with zlib.
+ * Interfaces added after Open go through the ring too, ahead of their frames,
+ * so one writer (one thread and one ring) serves the links of any number of
+ * MLDs. Frames arriving while the ring is full are dropped and counted, or
+ * wait for the writer thread with Backpressure.
+ */
+class MldPcapWriter : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    MldPcapWriter();
+    virtual ~MldPcapWriter();
+
+    /* add an interface capturing the frames sent and received by a PHY, until Close */
+    uint32_t ConnectLink(Ptr<WifiPhy> phy, std::string name);
+    /* add an interface fed with Capture */
+    uint32_t AddInterface(std::string name);
+    /* create the file, write the section and interface blocks and start the writer thread */
+    void Open(std::string filename);
+    /* queue a frame (MAC header, body and FCS) of an interface */
+    void Capture(uint32_t interfaceId, Ptr<const Packet> packet);
+    /* disconnect the PHYs, write the queued frames, stop the writer thread and close the file */
+    void Close();
+
+    /* get the name of the file actually written, ".gz" added when compressed */
+    std::string GetFilename();
+    /* get number of frames queued */
+    uint64_t GetCaptured();
+    /* get number of frames dropped because the ring was full */
+    uint64_t GetDropped();
+
+    /* MonitorSnifferTx sink */
+    static void SniffTx(MldPcapWriter *writer, uint32_t interfaceId, Ptr<const Packet> packet,
+                        uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu, uint16_t staId);
+    /* MonitorSnifferRx sink */
+    static void SniffRx(MldPcapWriter *writer, uint32_t interfaceId, Ptr<const Packet> packet,
+                        uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu,
+                        SignalNoiseDbm signalNoise, uint16_t staId);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    /* frame or interface waiting in the ring, its bytes (or name) in the data slot of the same index */
+    struct Record
+    {
+        bool     isInterface;   // interface block, the name being the data
+        uint64_t timestamp;     // nanoseconds
+        uint32_t interfaceId;
+        uint32_t length;        // original length
+        uint32_t captured;      // bytes copied, at most SnapLen
+    };
+
+    /* get the next free record of the ring, waiting for one if wait is set, 0 if full */
+    Record *Reserve(bool wait);
+    /* hand the reserved record to the writer thread */
+    void Commit();
+    /* write the block of an interface */
+    void WriteInterface(const std::string &name);
+    /* writer thread: drain the ring until closed */
+    void Run();
+    /* write a block, padded to 32 bits */
+    void WriteBlock(uint32_t type, const std::vector<uint8_t> &body);
+    /* write bytes to the (compressed) file */
+    void Write(const void *data, size_t size);
+
+    uint32_t    m_snapLen;              // bytes kept of every frame
+    uint32_t    m_queueSize;            // frames the ring holds
+    bool        m_compress;             // gzip the file
+    bool        m_backpressure;         // wait for the writer thread on a full ring instead of dropping
+    std::vector<std::pair<Ptr<WifiPhy>, uint32_t> > m_links;   // connected PHYs and their interface
+    std::vector<std::string> m_interfaces;  // interface names, by interface id
+    std::vector<Record> m_records;      // ring records
+    std::vector<uint8_t> m_data;        // ring frame bytes, m_snapLen per record
+    std::atomic<uint64_t> m_head;       // next record read by the writer thread
+    std::atomic<uint64_t> m_tail;       // next record written by the simulation thread
+    std::atomic<bool> m_stop;           // ask the writer thread to finish
+    uint64_t    m_captured;             // frames queued
+    uint64_t    m_dropped;              // frames dropped on a full ring
+    std::string m_filename;             // file written
+    std::FILE   *m_file;                // uncompressed output
+    void        *m_gzFile;              // compressed output (gzFile)
+    std::thread m_thread;               // writer thread
+};
+
+}   /* ns3 */
+
+#endif /* MLD_PCAP_WRITER_H */
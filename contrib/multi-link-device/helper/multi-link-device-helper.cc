@@ -1,11 +1,491 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
 #include "ns3/multi-link-device-helper.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/arp-cache.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-mac.h"
+#include "ns3/wifi-mac-queue.h"
+#include "ns3/wifi-remote-station-manager.h"
+#include "ns3/qos-utils.h"
+#include "ns3/qos-txop.h"
+#include "ns3/pointer.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <sstream>
 
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE("MultiLinkDeviceHelper");
 
+MultiLinkDeviceHelper::MultiLinkDeviceHelper()
+    : m_memoryInterval (Seconds(0)),
+      m_peakTotalBytes (0),
+      m_peakQueuedBytes (0),
+      m_pcapCaptured (0),
+      m_pcapDropped (0)
+{}
 
-}   /* ns3 */
+MultiLinkDeviceHelper::~MultiLinkDeviceHelper()
+{
+    CloseAsyncPcap();
+}
+
+NetDeviceContainer
+MultiLinkDeviceHelper::InstallLink(WifiHelper &wifi, Ptr<YansWifiChannel> channel, uint8_t channelNumber,
+                                   uint32_t frequency, Ssid ssid, bool isAP, NodeContainer nodes)
+{
+    YansWifiPhyHelper phy;
+    phy.SetChannel(channel);
+    phy.Set("ChannelNumber", UintegerValue(channelNumber));
+    phy.Set("ChannelWidth", UintegerValue(20));
+    phy.Set("Frequency", UintegerValue(frequency));
+
+    WifiMacHelper mac;
+    if(isAP)
+    {
+        mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid));
+    }
+    else
+    {
+        mac.SetType("ns3::StaWifiMac", "ActiveProbing", BooleanValue(false), "Ssid", SsidValue(ssid));
+    }
+    return wifi.Install(phy, mac, nodes);
+}
+
+std::vector<Ptr<MultiLinkDevice> >
+MultiLinkDeviceHelper::InstallMlds(WifiHelper &wifi, Ptr<YansWifiChannel> channel1, Ptr<YansWifiChannel> channel2,
+                                   std::string ssid, Ptr<Node> apNode, NodeContainer staNodes)
+{
+    /* every link is its own BSS */
+    Ssid ssid1 = Ssid(ssid + "-link1");
+    Ssid ssid2 = Ssid(ssid + "-link2");
+    NetDeviceContainer apDevice1 = InstallLink(wifi, channel1, 36, 5180, ssid1, true, NodeContainer(apNode));
+    NetDeviceContainer apDevice2 = InstallLink(wifi, channel2, 48, 5240, ssid2, true, NodeContainer(apNode));
+    NetDeviceContainer staDevices1 = InstallLink(wifi, channel1, 36, 5180, ssid1, false, staNodes);
+    NetDeviceContainer staDevices2 = InstallLink(wifi, channel2, 48, 5240, ssid2, false, staNodes);
+
+    std::vector<Ptr<MultiLinkDevice> > mlds;
+    Ptr<MultiLinkDevice> apMld = CreateObject<MultiLinkDevice>();
+    apMld->SetSTA1(apDevice1);
+    apMld->SetSTA2(apDevice2);
+    mlds.push_back(apMld);
+    for(uint32_t i = 0; i < staNodes.GetN(); i++)
+    {
+        Ptr<MultiLinkDevice> mld = CreateObject<MultiLinkDevice>();
+        mld->SetSTA1(NetDeviceContainer(staDevices1.Get(i)));
+        mld->SetSTA2(NetDeviceContainer(staDevices2.Get(i)));
+        mlds.push_back(mld);
+    }
+    return mlds;
+}
+
+std::vector<Ptr<MultiLinkDevice> >
+MultiLinkDeviceHelper::InstallReferenceScenario(uint32_t nMld, Time transitFreq, Time transitDelay)
+{
+    /* one node per MLD, holding the devices of both links */
+    NodeContainer apNode;
+    apNode.Create(1);
+    NodeContainer staNodes;
+    staNodes.Create(nMld);
+
+    WifiHelper wifi;
+    wifi.SetStandard(WIFI_STANDARD_80211ax_5GHZ);
+    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                 "DataMode", StringValue("HeMcs7"),
+                                 "ControlMode", StringValue("HeMcs0"));
+    YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
+    std::vector<Ptr<MultiLinkDevice> > mlds = InstallMlds(wifi, channel.Create(), channel.Create(), "mld",
+                                                          apNode.Get(0), staNodes);
+
+    /* square grid around the AP, at most 20 m wide so that thousands of STAs stay in range */
+    uint32_t gridWidth = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(nMld))));
+    double delta = std::min(1.0, 20.0 / gridWidth);
+    MobilityHelper mobility;
+    mobility.SetPositionAllocator("ns3::GridPositionAllocator",
+                                  "MinX", DoubleValue(-delta * gridWidth / 2), "MinY", DoubleValue(-delta * gridWidth / 2),
+                                  "DeltaX", DoubleValue(delta), "DeltaY", DoubleValue(delta),
+                                  "GridWidth", UintegerValue(gridWidth));
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.Install(staNodes);
+    mobility.SetPositionAllocator("ns3::GridPositionAllocator");
+    mobility.Install(apNode);
+
+    for(uint32_t i = 1; i < mlds.size(); i++)
+    {
+        mlds[i]->SetTransitFreq(transitFreq);
+        mlds[i]->SetTransitDelay(transitDelay);
+    }
+    return mlds;
+}
+
+void
+MultiLinkDeviceHelper::StartDirect(std::vector<Ptr<MultiLinkDevice> > mlds, DataRate cbrRate, Time start, Time spread)
+{
+    NS_ABORT_MSG_IF (mlds.empty(), "No AP MLD to start");
+    Ptr<MultiLinkDevice> apMld = mlds[0];
+    apMld->DirectSetting(Address(), Address(), cbrRate, true);
+    Ptr<UniformRandomVariable> offset = CreateObject<UniformRandomVariable>();
+    for(uint32_t i = 1; i < mlds.size(); i++)
+    {
+        /* STAs only send once associated, and spread their starts not to send in lockstep */
+        Time at = start + ((spread.IsStrictlyPositive())? Seconds(offset->GetValue(0, spread.GetSeconds())) : Seconds(0));
+        Simulator::Schedule(at, &MultiLinkDevice::DirectSetting, mlds[i],
+                            apMld->GetAddress1(), apMld->GetAddress2(), cbrRate, false);
+    }
+}
+
+void
+MultiLinkDeviceHelper::AddArpEntry(std::pair<Ptr<Ipv4>, uint32_t> interface, Ipv4Address peerAddress, Address peerMac)
+{
+    Ptr<Ipv4L3Protocol> l3 = interface.first->GetObject<Ipv4L3Protocol>();
+    NS_ABORT_MSG_IF (l3 == 0, "Node has no Ipv4L3Protocol, install the internet stack first");
+    Ptr<ArpCache> cache = l3->GetInterface(interface.second)->GetArpCache();
+    NS_ABORT_MSG_IF (cache == 0, "Interface " << interface.second << " has no ARP cache");
+
+    ArpCache::Entry *entry = cache->Lookup(peerAddress);
+    if(entry == 0)
+    {
+        entry = cache->Add(peerAddress);
+    }
+    entry->SetMacAddress(peerMac);
+    entry->MarkPermanent();
+}
+
+void
+MultiLinkDeviceHelper::ResetLinks(NetDeviceContainer devices, NetDeviceContainer peers)
+{
+    /* Txop attributes of the MAC, indexed by AcIndex */
+    static const char *txopNames[4] = { "BE_Txop", "BK_Txop", "VI_Txop", "VO_Txop" };
+    for(uint32_t i = 0; i < devices.GetN(); i++)
+    {
+        Ptr<WifiMac> mac = DynamicCast<WifiNetDevice>(devices.Get(i))->GetMac();
+        for(uint8_t ac = 0; ac < 4; ac++)
+        {
+            Ptr<WifiMacQueue> queue = mac->GetTxopQueue(static_cast<AcIndex>(ac));
+            if(queue != 0)
+            {
+                queue->Flush();
+            }
+        }
+        /* after the flush, so that the DELBA frames are not flushed with the data */
+        for(uint8_t tid = 0; tid < 8; tid++)
+        {
+            PointerValue txopValue;
+            mac->GetAttributeFailSafe(txopNames[QosUtilsMapTidToAc(tid)], txopValue);
+            Ptr<QosTxop> txop = txopValue.Get<QosTxop>();
+            if(txop == 0)
+            {
+                continue;
+            }
+            for(uint32_t j = 0; j < peers.GetN(); j++)
+            {
+                Mac48Address peer = Mac48Address::ConvertFrom(peers.Get(j)->GetAddress());
+                if(txop->GetBaAgreementEstablished(peer, tid))
+                {
+                    txop->SendDelbaFrame(peer, tid, true);
+                }
+            }
+        }
+    }
+}
+
+std::string
+MultiLinkDeviceHelper::GetSsid(Ptr<NetDevice> device)
+{
+    Ptr<WifiNetDevice> wifiDevice = DynamicCast<WifiNetDevice>(device);
+    NS_ABORT_MSG_IF (wifiDevice == 0, "Star topologies are made of WifiNetDevices");
+    return wifiDevice->GetMac()->GetSsid().PeekString();
+}
+
+std::map<std::string, std::vector<uint32_t> >
+MultiLinkDeviceHelper::GetBssAps(NetDeviceContainer apDevices)
+{
+    std::map<std::string, std::vector<uint32_t> > bssAps;
+    for(uint32_t ap = 0; ap < apDevices.GetN(); ap++)
+    {
+        bssAps[GetSsid(apDevices.Get(ap))].push_back(ap);
+    }
+    return bssAps;
+}
+
+void
+MultiLinkDeviceHelper::AssignStar(Ipv4AddressHelper &address, NetDeviceContainer apDevices, NetDeviceContainer staDevices,
+                                  Ipv4InterfaceContainer &apInterfaces, Ipv4InterfaceContainer &staInterfaces)
+{
+    staInterfaces = address.Assign(staDevices);
+    apInterfaces = address.Assign(apDevices);
+
+    /* every STA only talks to the AP(s) of its SSID: O(nSta) entries instead of a global SPF */
+    std::map<std::string, std::vector<uint32_t> > bssAps = GetBssAps(apDevices);
+    for(uint32_t sta = 0; sta < staInterfaces.GetN(); sta++)
+    {
+        std::vector<uint32_t> &aps = bssAps[GetSsid(staDevices.Get(sta))];
+        for(std::vector<uint32_t>::iterator ap = aps.begin(); ap != aps.end(); ++ap)
+        {
+            AddArpEntry(staInterfaces.Get(sta), apInterfaces.GetAddress(*ap), apDevices.Get(*ap)->GetAddress());
+            AddArpEntry(apInterfaces.Get(*ap), staInterfaces.GetAddress(sta), staDevices.Get(sta)->GetAddress());
+        }
+    }
+    NS_LOG_INFO("[Star] " << staInterfaces.GetN() << " STAs, " << apInterfaces.GetN() << " APs");
+}
+
+void
+MultiLinkDeviceHelper::AssignStar(Ipv4AddressHelper &address1, Ipv4AddressHelper &address2,
+                                  Ptr<MultiLinkDevice> apMld, std::vector<Ptr<MultiLinkDevice> > staMlds,
+                                  Ipv4InterfaceContainer &link1Interfaces, Ipv4InterfaceContainer &link2Interfaces)
+{
+    NetDeviceContainer staDevices1, staDevices2;
+    for(std::vector<Ptr<MultiLinkDevice> >::iterator it = staMlds.begin(); it != staMlds.end(); ++it)
+    {
+        staDevices1.Add((*it)->GetSTA1());
+        staDevices2.Add((*it)->GetSTA2());
+    }
 
+    Ipv4InterfaceContainer apInterfaces, staInterfaces;
+    AssignStar(address1, NetDeviceContainer(apMld->GetSTA1()), staDevices1, apInterfaces, staInterfaces);
+    link1Interfaces = apInterfaces;
+    link1Interfaces.Add(staInterfaces);
+
+    apInterfaces = Ipv4InterfaceContainer();
+    staInterfaces = Ipv4InterfaceContainer();
+    AssignStar(address2, NetDeviceContainer(apMld->GetSTA2()), staDevices2, apInterfaces, staInterfaces);
+    link2Interfaces = apInterfaces;
+    link2Interfaces.Add(staInterfaces);
+}
+
+bool
+MultiLinkDeviceHelper::VerifyStar(Ipv4InterfaceContainer apInterfaces, Ipv4InterfaceContainer staInterfaces)
+{
+    bool ok = true;
+    NetDeviceContainer apDevices;
+    for(uint32_t ap = 0; ap < apInterfaces.GetN(); ap++)
+    {
+        apDevices.Add(apInterfaces.Get(ap).first->GetNetDevice(apInterfaces.Get(ap).second));
+    }
+    std::map<std::string, std::vector<uint32_t> > bssAps = GetBssAps(apDevices);
+    for(uint32_t sta = 0; sta < staInterfaces.GetN(); sta++)
+    {
+        std::vector<uint32_t> &aps = bssAps[GetSsid(staInterfaces.Get(sta).first->GetNetDevice(staInterfaces.Get(sta).second))];
+        for(std::vector<uint32_t>::iterator it = aps.begin(); it != aps.end(); ++it)
+        {
+            uint32_t ap = *it;
+            /* check both directions of every AP/STA pair of a BSS */
+            for(uint32_t dir = 0; dir < 2; dir++)
+            {
+                std::pair<Ptr<Ipv4>, uint32_t> src = (dir == 0)? staInterfaces.Get(sta) : apInterfaces.Get(ap);
+                Ipv4Address dst = (dir == 0)? apInterfaces.GetAddress(ap) : staInterfaces.GetAddress(sta);
+                Ptr<NetDevice> device = src.first->GetNetDevice(src.second);
+
+                Ipv4Header header;
+                header.SetDestination(dst);
+                Socket::SocketErrno err;
+                Ptr<Ipv4Route> route = src.first->GetRoutingProtocol()->RouteOutput(Ptr<Packet>(), header, device, err);
+                if(route == 0 || route->GetOutputDevice() != device || route->GetGateway() != Ipv4Address::GetAny())
+                {
+                    NS_LOG_WARN("[Verify] no on-link route to " << dst << " through interface " << src.second);
+                    ok = false;
+                    continue;
+                }
+
+                Ptr<ArpCache> cache = src.first->GetObject<Ipv4L3Protocol>()->GetInterface(src.second)->GetArpCache();
+                ArpCache::Entry *entry = cache->Lookup(dst);
+                if(entry == 0 || !entry->IsPermanent())
+                {
+                    NS_LOG_WARN("[Verify] no ARP entry for " << dst << " on interface " << src.second);
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+void
+MultiLinkDeviceHelper::EnableMemoryAccounting(std::vector<Ptr<MultiLinkDevice> > mlds, Time interval)
+{
+    m_accountedMlds = mlds;
+    m_memoryInterval = interval;
+    m_peakTotalBytes = 0;
+    m_peakQueuedBytes = 0;
+    m_memoryEvent.Cancel();
+    SampleMemory();
+}
+
+uint64_t
+MultiLinkDeviceHelper::GetObjectBytes(Ptr<const Object> object)
+{
+    if(object == 0)
+    {
+        return 0;
+    }
+    /* sizes are registered by NS_OBJECT_ENSURE_REGISTERED, other subclasses count as their closest registered parent */
+    TypeId tid = object->GetInstanceTypeId();
+    while(tid.GetSize() == static_cast<std::size_t>(-1) && tid.HasParent() && tid.GetParent() != tid)
+    {
+        tid = tid.GetParent();
+    }
+    return (tid.GetSize() == static_cast<std::size_t>(-1))? sizeof(Object) : tid.GetSize();
+}
+
+uint64_t
+MultiLinkDeviceHelper::GetLinkDeviceBytes(Ptr<WifiNetDevice> device, uint64_t &queuedPackets, uint64_t &queuedBytes)
+{
+    uint64_t bytes = GetObjectBytes(device);
+    bytes += GetObjectBytes(device->GetPhy());
+    bytes += GetObjectBytes(device->GetRemoteStationManager());
+
+    Ptr<WifiMac> mac = device->GetMac();
+    bytes += GetObjectBytes(mac);
+    AcIndex acList[4] = { AC_BE, AC_BK, AC_VI, AC_VO };
+    for(uint8_t ac = 0; ac < 4; ac++)
+    {
+        Ptr<WifiMacQueue> queue = mac->GetTxopQueue(acList[ac]);
+        if(queue == 0)
+        {
+            continue;
+        }
+        bytes += GetObjectBytes(queue);
+        /* every queued frame holds its buffer, a Packet and a queue item with the MAC header */
+        queuedPackets += queue->GetNPackets();
+        queuedBytes += queue->GetNBytes() + queue->GetNPackets() * (sizeof(Packet) + sizeof(WifiMacQueueItem));
+    }
+    return bytes;
+}
+
+MultiLinkDeviceHelper::MemoryReport
+MultiLinkDeviceHelper::GetMemoryReport()
+{
+    MemoryReport report = MemoryReport();
+    std::set<Ptr<Node> > nodes;
+    for(std::vector<Ptr<MultiLinkDevice> >::iterator it = m_accountedMlds.begin(); it != m_accountedMlds.end(); ++it)
+    {
+        report.mlds++;
+        report.mldBytes += (*it)->GetMemoryUsage();
+        Ptr<WifiNetDevice> links[2] = { (*it)->GetSTA1(), (*it)->GetSTA2() };
+        for(uint32_t i = 0; i < 2; i++)
+        {
+            if(links[i] == 0)
+            {
+                continue;
+            }
+            report.linkDevices++;
+            report.linkDeviceBytes += GetLinkDeviceBytes(links[i], report.queuedPackets, report.queuedBytes);
+            nodes.insert(links[i]->GetNode());
+        }
+    }
+    /* the aggregates of a node include the node itself */
+    for(std::set<Ptr<Node> >::iterator it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        Object::AggregateIterator aggregates = (*it)->GetAggregateIterator();
+        while(aggregates.HasNext())
+        {
+            report.nodeBytes += GetObjectBytes(aggregates.Next());
+        }
+    }
+    report.nodes = nodes.size();
+    report.totalBytes = report.nodeBytes + report.mldBytes + report.linkDeviceBytes + report.queuedBytes;
+
+    m_peakTotalBytes = std::max(m_peakTotalBytes, report.totalBytes);
+    m_peakQueuedBytes = std::max(m_peakQueuedBytes, report.queuedBytes);
+    report.peakTotalBytes = m_peakTotalBytes;
+    report.peakQueuedBytes = m_peakQueuedBytes;
+    return report;
+}
+
+void
+MultiLinkDeviceHelper::SampleMemory()
+{
+    GetMemoryReport();
+    if(m_memoryInterval.IsStrictlyPositive())
+    {
+        m_memoryEvent = Simulator::Schedule(m_memoryInterval, &MultiLinkDeviceHelper::SampleMemory, this);
+    }
+}
+
+void
+MultiLinkDeviceHelper::PrintMemoryReport(std::ostream &os)
+{
+    MemoryReport report = GetMemoryReport();
+    os << "Memory: " << report.totalBytes << " bytes (peak " << report.peakTotalBytes << ")" << std::endl;
+    os << "  nodes:        " << report.nodeBytes << " bytes, "
+       << ((report.nodes > 0)? report.nodeBytes / report.nodes : 0) << " per node" << std::endl;
+    os << "  MLDs:         " << report.mldBytes << " bytes, "
+       << ((report.mlds > 0)? report.mldBytes / report.mlds : 0) << " per MLD" << std::endl;
+    os << "  link devices: " << report.linkDeviceBytes << " bytes, "
+       << ((report.linkDevices > 0)? report.linkDeviceBytes / report.linkDevices : 0) << " per link device" << std::endl;
+    os << "  queued:       " << report.queuedBytes << " bytes (peak " << report.peakQueuedBytes << ") in "
+       << report.queuedPackets << " packets, "
+       << ((report.queuedPackets > 0)? report.queuedBytes / report.queuedPackets : 0) << " per packet" << std::endl;
+}
+
+Ptr<MldPcapWriter>
+MultiLinkDeviceHelper::EnableAsyncPcap(std::string prefix, Ptr<MultiLinkDevice> mld, uint32_t snapLen, bool compress)
+{
+    Ptr<MldPcapWriter> &writer = m_pcapWriters[prefix];
+    if(writer == 0)
+    {
+        writer = CreateObject<MldPcapWriter>();
+        writer->SetAttribute("SnapLen", UintegerValue(snapLen));
+        writer->SetAttribute("Compress", BooleanValue(compress));
+        writer->Open(prefix + ".pcapng");
+    }
+    std::ostringstream name;
+    name << "node" << mld->GetSTA1()->GetNode()->GetId();
+    writer->ConnectLink(mld->GetSTA1()->GetPhy(), name.str() + "-link1");
+    writer->ConnectLink(mld->GetSTA2()->GetPhy(), name.str() + "-link2");
+    return writer;
+}
+
+uint64_t
+MultiLinkDeviceHelper::GetPcapCaptured()
+{
+    uint64_t captured = m_pcapCaptured;
+    for(std::map<std::string, Ptr<MldPcapWriter> >::iterator it = m_pcapWriters.begin(); it != m_pcapWriters.end(); ++it)
+    {
+        captured += it->second->GetCaptured();
+    }
+    return captured;
+}
+
+uint64_t
+MultiLinkDeviceHelper::GetPcapDropped()
+{
+    uint64_t dropped = m_pcapDropped;
+    for(std::map<std::string, Ptr<MldPcapWriter> >::iterator it = m_pcapWriters.begin(); it != m_pcapWriters.end(); ++it)
+    {
+        dropped += it->second->GetDropped();
+    }
+    return dropped;
+}
+
+void
+MultiLinkDeviceHelper::CloseAsyncPcap()
+{
+    for(std::map<std::string, Ptr<MldPcapWriter> >::iterator it = m_pcapWriters.begin(); it != m_pcapWriters.end(); ++it)
+    {
+        it->second->Close();
+        m_pcapCaptured += it->second->GetCaptured();
+        m_pcapDropped += it->second->GetDropped();
+    }
+    m_pcapWriters.clear();
+}
+
+}   /* ns3 */
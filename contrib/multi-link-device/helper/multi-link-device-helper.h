@@ -3,13 +3,140 @@
 #define MULTI_LINK_DEVICE_HELPER_H
 
 #include "ns3/multi-link-device.h"
+#include "ns3/mld-pcap-writer.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/wifi-helper.h"
+#include "ns3/yans-wifi-channel.h"
+#include "ns3/ssid.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-interface-container.h"
+#include "ns3/event-id.h"
+
+#include <map>
+#include <ostream>
+#include <vector>
 
 
 namespace ns3 {
 
+class MultiLinkDeviceHelper
+{
+public:
+    /* memory footprint of the accounted MLDs, in bytes */
+    struct MemoryReport
+    {
+        uint32_t nodes;              // distinct nodes holding the link devices
+        uint32_t mlds;               // accounted MLDs
+        uint32_t linkDevices;        // affiliated WifiNetDevices
+        uint64_t nodeBytes;          // nodes and their aggregated objects (IP stack, mobility...)
+        uint64_t mldBytes;           // MLDs, their sockets and cached/retransmission packets
+        uint64_t linkDeviceBytes;    // WifiNetDevice, PHY, MAC, MAC queues and station manager of every link
+        uint64_t queuedPackets;      // packets waiting in the MAC queues of the links
+        uint64_t queuedBytes;        // memory held by the queued packets
+        uint64_t totalBytes;         // sum of the above
+        uint64_t peakTotalBytes;     // highest total seen since accounting was enabled
+        uint64_t peakQueuedBytes;    // highest queued packet memory seen since accounting was enabled
+    };
+
+    MultiLinkDeviceHelper();
+    virtual ~MultiLinkDeviceHelper();
+
+    /* install the 20 MHz devices of one link on every node, APs or STAs (passive scanning) of ssid */
+    static NetDeviceContainer InstallLink(WifiHelper &wifi, Ptr<YansWifiChannel> channel, uint8_t channelNumber,
+                                          uint32_t frequency, Ssid ssid, bool isAP, NodeContainer nodes);
+    /* install an AP MLD on apNode and a STA MLD on every STA node, link 1 on channel 36 (5180 MHz) of
+       channel1 and link 2 on channel 48 (5240 MHz) of channel2: MLDs hold the AP MLD first, then the
+       STA MLDs in order */
+    static std::vector<Ptr<MultiLinkDevice> > InstallMlds(WifiHelper &wifi, Ptr<YansWifiChannel> channel1,
+                                                          Ptr<YansWifiChannel> channel2, std::string ssid,
+                                                          Ptr<Node> apNode, NodeContainer staNodes);
+    /* reference scenario of the benchmarks: an AP MLD and nMld STA MLDs installed by InstallMlds
+       (HE, HeMcs7 data, one default Yans channel per link) on new nodes, STAs on a grid of at most
+       20 m around the AP, every STA MLD switching links every transitFreq in transitDelay */
+    static std::vector<Ptr<MultiLinkDevice> > InstallReferenceScenario(uint32_t nMld, Time transitFreq,
+                                                                       Time transitDelay);
+    /* start the direct mode of MLDs installed by InstallMlds: the AP MLD now, every STA MLD at a
+       time drawn uniformly in [start, start + spread) sending cbrRate to the AP MLD */
+    static void StartDirect(std::vector<Ptr<MultiLinkDevice> > mlds, DataRate cbrRate, Time start, Time spread);
+    /* reuse a topology at another rate: drop the frames queued by the devices, then tear down the
+       Block Ack agreements they hold with the peers (DELBA), so that no reorder buffer waits for
+       a flushed sequence number */
+    static void ResetLinks(NetDeviceContainer devices, NetDeviceContainer peers);
+
+    /*
+     * Fast L3 setup of a single-hop BSS (star topology), replacing
+     * Ipv4GlobalRoutingHelper::PopulateRoutingTables: addresses are assigned
+     * to the STAs then to the APs, and permanent ARP entries between every
+     * STA and the AP(s) of its SSID are installed, all in one linear pass. The on-link
+     * route to the BSS subnet is added by Ipv4StaticRouting when the
+     * interfaces go up, so no routing computation is needed.
+     */
+    void AssignStar(Ipv4AddressHelper &address, NetDeviceContainer apDevices, NetDeviceContainer staDevices,
+                    Ipv4InterfaceContainer &apInterfaces, Ipv4InterfaceContainer &staInterfaces);
+    /* same as above for every affiliated link of the MLDs, each link being its own BSS/subnet:
+       interfaces of a link hold the AP MLD first, then the STA MLDs in order */
+    void AssignStar(Ipv4AddressHelper &address1, Ipv4AddressHelper &address2,
+                    Ptr<MultiLinkDevice> apMld, std::vector<Ptr<MultiLinkDevice> > staMlds,
+                    Ipv4InterfaceContainer &link1Interfaces, Ipv4InterfaceContainer &link2Interfaces);
+    /* check that every STA and the AP(s) of its SSID reach each other on-link through their BSS
+       device with a resolved ARP entry, i.e. what global routing computes for a single-hop BSS */
+    bool VerifyStar(Ipv4InterfaceContainer apInterfaces, Ipv4InterfaceContainer staInterfaces);
 
+    /*
+     * Opt-in memory accounting of MLDs: objects are counted with the size they are
+     * registered with (TypeId::GetSize), queued packets with their buffer and queue
+     * item. Containers private to ns-3 objects (ARP caches, station manager states,
+     * interference events...) are not seen, so the figures are lower bounds.
+     * The footprint is sampled every interval to track peaks; the helper must
+     * outlive the simulation.
+     */
+    void EnableMemoryAccounting(std::vector<Ptr<MultiLinkDevice> > mlds, Time interval);
+    /* get the current footprint and the peaks of the accounted MLDs */
+    MemoryReport GetMemoryReport();
+    /* print the memory report, with the cost per node, MLD, link device and queued packet */
+    void PrintMemoryReport(std::ostream &os);
+
+    /*
+     * Capture both affiliated links of an MLD into <prefix>.pcapng, off the simulation
+     * thread (see MldPcapWriter). The MLDs of a prefix share one writer, thread and
+     * ring, each link being an interface named node<node id>-link1/2. Frames are
+     * truncated to snapLen bytes and the file is gzipped if compress is set and zlib
+     * is available; snapLen and compress are those of the first MLD of a prefix.
+     * Captures are closed by CloseAsyncPcap or with the helper.
+     */
+    Ptr<MldPcapWriter> EnableAsyncPcap(std::string prefix, Ptr<MultiLinkDevice> mld, uint32_t snapLen, bool compress);
+    /* frames queued by every capture */
+    uint64_t GetPcapCaptured();
+    /* frames dropped by every capture on a full ring */
+    uint64_t GetPcapDropped();
+    /* write the remaining frames and close every capture */
+    void CloseAsyncPcap();
+
+private:
+    /* SSID of a Wi-Fi device */
+    static std::string GetSsid(Ptr<NetDevice> device);
+    /* indices of the APs of every SSID */
+    static std::map<std::string, std::vector<uint32_t> > GetBssAps(NetDeviceContainer apDevices);
+    /* install a permanent ARP entry for a peer on an interface */
+    void AddArpEntry(std::pair<Ptr<Ipv4>, uint32_t> interface, Ipv4Address peerAddress, Address peerMac);
+    /* registered size of an object, or of its closest registered parent */
+    uint64_t GetObjectBytes(Ptr<const Object> object);
+    /* size of a link device and of the objects it owns, adding its queued packets to the counters */
+    uint64_t GetLinkDeviceBytes(Ptr<WifiNetDevice> device, uint64_t &queuedPackets, uint64_t &queuedBytes);
+    /* sample the footprint and update the peaks */
+    void SampleMemory();
+
+    std::vector<Ptr<MultiLinkDevice> > m_accountedMlds;    // MLDs of the memory accounting
+    Time        m_memoryInterval;      // memory sampling interval
+    EventId     m_memoryEvent;         // next memory sample
+    uint64_t    m_peakTotalBytes;      // highest total footprint sampled
+    uint64_t    m_peakQueuedBytes;     // highest queued packet memory sampled
+    std::map<std::string, Ptr<MldPcapWriter> > m_pcapWriters;   // asynchronous captures, by prefix
+    uint64_t    m_pcapCaptured;        // frames queued by the closed captures
+    uint64_t    m_pcapDropped;         // frames dropped by the closed captures
+};
 
 }   /* ns3 */
 
 #endif /* MULTI_LINK_DEVICE_HELPER_H */
-
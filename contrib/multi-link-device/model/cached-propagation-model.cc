@@ -0,0 +1,293 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/cached-propagation-model.h"
+#include "ns3/pointer.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("CachedPropagationModel");
+
+/* ------------------------------------------------------------------------ */
+
+PropagationPairCache::PropagationPairCache()
+    : m_hits (0),
+      m_misses (0),
+      m_invalidations (0)
+{}
+
+uint32_t
+PropagationPairCache::GetIndex(Ptr<MobilityModel> mobility)
+{
+    std::unordered_map<const MobilityModel *, uint32_t>::iterator it = m_index.find(PeekPointer(mobility));
+    if(it != m_index.end())
+    {
+        return it->second;
+    }
+
+    uint32_t index = m_mobility.size();
+    m_index[PeekPointer(mobility)] = index;
+    m_mobility.push_back(mobility);
+    m_rows.push_back(std::unordered_map<uint32_t, double>());
+    m_columns.push_back(std::unordered_set<uint32_t>());
+    mobility->TraceConnectWithoutContext("CourseChange", MakeCallback(&PropagationPairCache::Invalidate, this));
+    return index;
+}
+
+bool
+PropagationPairCache::Lookup(Ptr<MobilityModel> a, Ptr<MobilityModel> b, double &value)
+{
+    uint32_t i = GetIndex(a);
+    uint32_t j = GetIndex(b);
+    std::unordered_map<uint32_t, double>::const_iterator it = m_rows[i].find(j);
+    if(it == m_rows[i].end())
+    {
+        m_misses++;
+        return false;
+    }
+    m_hits++;
+    value = it->second;
+    return true;
+}
+
+void
+PropagationPairCache::Store(Ptr<MobilityModel> a, Ptr<MobilityModel> b, double value)
+{
+    uint32_t i = GetIndex(a);
+    uint32_t j = GetIndex(b);
+    m_rows[i][j] = value;
+    m_columns[j].insert(i);
+}
+
+void
+PropagationPairCache::Invalidate(Ptr<const MobilityModel> mobility)
+{
+    std::unordered_map<const MobilityModel *, uint32_t>::iterator it = m_index.find(PeekPointer(mobility));
+    if(it == m_index.end())
+    {
+        return;
+    }
+    uint32_t k = it->second;
+    if(m_rows[k].empty() && m_columns[k].empty())
+    {
+        return;
+    }
+    /* drop (k, j) and (i, k), only the pairs actually stored are visited */
+    for(std::unordered_map<uint32_t, double>::const_iterator j = m_rows[k].begin(); j != m_rows[k].end(); ++j)
+    {
+        m_columns[j->first].erase(k);
+    }
+    m_rows[k].clear();
+    for(std::unordered_set<uint32_t>::const_iterator i = m_columns[k].begin(); i != m_columns[k].end(); ++i)
+    {
+        m_rows[*i].erase(k);
+    }
+    m_columns[k].clear();
+    m_invalidations++;
+}
+
+void
+PropagationPairCache::Clear()
+{
+    for(std::vector<Ptr<MobilityModel> >::iterator it = m_mobility.begin(); it != m_mobility.end(); ++it)
+    {
+        (*it)->TraceDisconnectWithoutContext("CourseChange", MakeCallback(&PropagationPairCache::Invalidate, this));
+    }
+    m_mobility.clear();
+    m_index.clear();
+    m_rows.clear();
+    m_columns.clear();
+}
+
+uint64_t
+PropagationPairCache::GetHits()
+{
+    return m_hits;
+}
+
+uint64_t
+PropagationPairCache::GetMisses()
+{
+    return m_misses;
+}
+
+uint64_t
+PropagationPairCache::GetInvalidations()
+{
+    return m_invalidations;
+}
+
+/* ------------------------------------------------------------------------ */
+
+NS_OBJECT_ENSURE_REGISTERED (CachedPropagationLossModel);
+
+TypeId
+CachedPropagationLossModel::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::CachedPropagationLossModel")
+        .SetParent<PropagationLossModel> ()
+        .AddConstructor<CachedPropagationLossModel> ()
+        .AddAttribute ("Model",
+                       "The wrapped deterministic loss model",
+                       PointerValue (),
+                       MakePointerAccessor (&CachedPropagationLossModel::m_model),
+                       MakePointerChecker<PropagationLossModel> ());
+
+        return tid;
+}
+
+CachedPropagationLossModel::CachedPropagationLossModel()
+{}
+
+CachedPropagationLossModel::~CachedPropagationLossModel()
+{}
+
+void
+CachedPropagationLossModel::DoDispose (void)
+{
+    NS_LOG_INFO("[Cache] loss hits " << m_cache.GetHits() << ", misses " << m_cache.GetMisses()
+                << ", invalidations " << m_cache.GetInvalidations());
+    m_cache.Clear();
+    m_model = 0;
+    PropagationLossModel::DoDispose ();
+}
+
+void
+CachedPropagationLossModel::SetModel(Ptr<PropagationLossModel> model)
+{
+    m_model = model;
+    m_cache.Clear();
+}
+
+Ptr<PropagationLossModel>
+CachedPropagationLossModel::GetModel()
+{
+    return m_model;
+}
+
+double
+CachedPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+    NS_ABORT_MSG_IF (m_model == 0, "CachedPropagationLossModel has no wrapped model");
+    double lossDb;
+    if(!m_cache.Lookup(a, b, lossDb))
+    {
+        lossDb = txPowerDbm - m_model->CalcRxPower(txPowerDbm, a, b);
+        m_cache.Store(a, b, lossDb);
+    }
+    return txPowerDbm - lossDb;
+}
+
+int64_t
+CachedPropagationLossModel::DoAssignStreams (int64_t stream)
+{
+    return (m_model == 0)? 0 : m_model->AssignStreams(stream);
+}
+
+uint64_t
+CachedPropagationLossModel::GetHits()
+{
+    return m_cache.GetHits();
+}
+
+uint64_t
+CachedPropagationLossModel::GetMisses()
+{
+    return m_cache.GetMisses();
+}
+
+uint64_t
+CachedPropagationLossModel::GetInvalidations()
+{
+    return m_cache.GetInvalidations();
+}
+
+/* ------------------------------------------------------------------------ */
+
+NS_OBJECT_ENSURE_REGISTERED (CachedPropagationDelayModel);
+
+TypeId
+CachedPropagationDelayModel::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::CachedPropagationDelayModel")
+        .SetParent<PropagationDelayModel> ()
+        .AddConstructor<CachedPropagationDelayModel> ()
+        .AddAttribute ("Model",
+                       "The wrapped deterministic delay model",
+                       PointerValue (),
+                       MakePointerAccessor (&CachedPropagationDelayModel::m_model),
+                       MakePointerChecker<PropagationDelayModel> ());
+
+        return tid;
+}
+
+CachedPropagationDelayModel::CachedPropagationDelayModel()
+{}
+
+CachedPropagationDelayModel::~CachedPropagationDelayModel()
+{}
+
+void
+CachedPropagationDelayModel::DoDispose (void)
+{
+    NS_LOG_INFO("[Cache] delay hits " << m_cache.GetHits() << ", misses " << m_cache.GetMisses()
+                << ", invalidations " << m_cache.GetInvalidations());
+    m_cache.Clear();
+    m_model = 0;
+    PropagationDelayModel::DoDispose ();
+}
+
+void
+CachedPropagationDelayModel::SetModel(Ptr<PropagationDelayModel> model)
+{
+    m_model = model;
+    m_cache.Clear();
+}
+
+Ptr<PropagationDelayModel>
+CachedPropagationDelayModel::GetModel()
+{
+    return m_model;
+}
+
+Time
+CachedPropagationDelayModel::GetDelay (Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+    NS_ABORT_MSG_IF (m_model == 0, "CachedPropagationDelayModel has no wrapped model");
+    double steps;
+    if(!m_cache.Lookup(a, b, steps))
+    {
+        Time delay = m_model->GetDelay(a, b);
+        m_cache.Store(a, b, static_cast<double>(delay.GetTimeStep()));
+        return delay;
+    }
+    return TimeStep(static_cast<uint64_t>(steps));
+}
+
+int64_t
+CachedPropagationDelayModel::DoAssignStreams (int64_t stream)
+{
+    return (m_model == 0)? 0 : m_model->AssignStreams(stream);
+}
+
+uint64_t
+CachedPropagationDelayModel::GetHits()
+{
+    return m_cache.GetHits();
+}
+
+uint64_t
+CachedPropagationDelayModel::GetMisses()
+{
+    return m_cache.GetMisses();
+}
+
+uint64_t
+CachedPropagationDelayModel::GetInvalidations()
+{
+    return m_cache.GetInvalidations();
+}
+
+}   /* ns3 */
+
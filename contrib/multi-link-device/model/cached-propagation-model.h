@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef CACHED_PROPAGATION_MODEL_H
+#define CACHED_PROPAGATION_MODEL_H
+
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/mobility-model.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Pairwise cache of a propagation quantity between mobility models.
+ *
+ * Every mobility model gets an index the first time it is seen and values
+ * are kept in a sparse row per index holding only the pairs actually
+ * computed. Entries of a mobility model are invalidated when it fires its
+ * CourseChange trace, so only static nodes are served from the cache.
+ */
+class PropagationPairCache
+{
+public:
+    PropagationPairCache();
+
+    /* get the cached value of a pair, return false on a miss */
+    bool Lookup(Ptr<MobilityModel> a, Ptr<MobilityModel> b, double &value);
+    /* store the value of a pair */
+    void Store(Ptr<MobilityModel> a, Ptr<MobilityModel> b, double value);
+    /* invalidate every entry of a mobility model */
+    void Invalidate(Ptr<const MobilityModel> mobility);
+    /* drop every entry and disconnect from every mobility model */
+    void Clear();
+
+    uint64_t GetHits();
+    uint64_t GetMisses();
+    uint64_t GetInvalidations();
+
+private:
+    /* get (and assign if needed) the index of a mobility model */
+    uint32_t GetIndex(Ptr<MobilityModel> mobility);
+
+    std::unordered_map<const MobilityModel *, uint32_t> m_index;   // index of every mobility model
+    std::vector<Ptr<MobilityModel> > m_mobility;    // mobility model of every index
+    std::vector<std::unordered_map<uint32_t, double> > m_rows;     // value of (i, j) by j in row i
+    std::vector<std::unordered_set<uint32_t> > m_columns;          // rows i holding (i, j) in column j
+    uint64_t    m_hits;             // lookups served from the cache
+    uint64_t    m_misses;           // lookups computed by the wrapped model
+    uint64_t    m_invalidations;    // course changes that dropped entries
+};
+
+/*
+ * Loss model caching the loss (dB) computed by a wrapped deterministic
+ * model for every pair of static nodes.
+ */
+class CachedPropagationLossModel : public PropagationLossModel
+{
+public:
+    static TypeId GetTypeId (void);
+
+    CachedPropagationLossModel();
+    virtual ~CachedPropagationLossModel();
+
+    /* set the wrapped loss model, its loss must not depend on tx power nor be random */
+    void SetModel(Ptr<PropagationLossModel> model);
+    /* get the wrapped loss model */
+    Ptr<PropagationLossModel> GetModel();
+    /* get number of losses served from the cache */
+    uint64_t GetHits();
+    /* get number of losses computed by the wrapped model */
+    uint64_t GetMisses();
+    /* get number of course changes that invalidated entries */
+    uint64_t GetInvalidations();
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+    virtual int64_t DoAssignStreams (int64_t stream);
+
+    Ptr<PropagationLossModel> m_model;          // wrapped loss model
+    mutable PropagationPairCache m_cache;       // loss (dB) of every pair
+};
+
+/*
+ * Delay model caching the delay computed by a wrapped deterministic model
+ * for every pair of static nodes.
+ */
+class CachedPropagationDelayModel : public PropagationDelayModel
+{
+public:
+    static TypeId GetTypeId (void);
+
+    CachedPropagationDelayModel();
+    virtual ~CachedPropagationDelayModel();
+
+    /* set the wrapped delay model, its delay must not be random */
+    void SetModel(Ptr<PropagationDelayModel> model);
+    /* get the wrapped delay model */
+    Ptr<PropagationDelayModel> GetModel();
+    virtual Time GetDelay (Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+    /* get number of delays served from the cache */
+    uint64_t GetHits();
+    /* get number of delays computed by the wrapped model */
+    uint64_t GetMisses();
+    /* get number of course changes that invalidated entries */
+    uint64_t GetInvalidations();
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    virtual int64_t DoAssignStreams (int64_t stream);
+
+    Ptr<PropagationDelayModel> m_model;         // wrapped delay model
+    mutable PropagationPairCache m_cache;       // delay (time steps) of every pair
+};
+
+}   /* ns3 */
+
+#endif /* CACHED_PROPAGATION_MODEL_H */
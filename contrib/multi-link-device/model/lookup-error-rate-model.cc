@@ -0,0 +1,363 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/lookup-error-rate-model.h"
+#include "ns3/nist-error-rate-model.h"
+#include "ns3/wifi-tx-vector.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("LookupErrorRateModel");
+
+NS_OBJECT_ENSURE_REGISTERED (LookupErrorRateModel);
+
+/* per-bit loss floor, keeps the log of the loss finite when the chunk always succeeds */
+static const double MIN_BIT_LOSS = 1e-300;
+
+TypeId
+LookupErrorRateModel::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::LookupErrorRateModel")
+        .SetParent<ErrorRateModel> ()
+        .AddConstructor<LookupErrorRateModel> ()
+        .AddAttribute ("MinSnr",
+                       "Lowest SNR (dB) of the lookup grid",
+                       DoubleValue (-10.0),
+                       MakeDoubleAccessor (&LookupErrorRateModel::m_minSnrDb),
+                       MakeDoubleChecker<double> ())
+        .AddAttribute ("MaxSnr",
+                       "Highest SNR (dB) of the lookup grid",
+                       DoubleValue (50.0),
+                       MakeDoubleAccessor (&LookupErrorRateModel::m_maxSnrDb),
+                       MakeDoubleChecker<double> ())
+        .AddAttribute ("SnrStep",
+                       "SNR (dB) step of the lookup grid",
+                       DoubleValue (0.1),
+                       MakeDoubleAccessor (&LookupErrorRateModel::m_snrStepDb),
+                       MakeDoubleChecker<double> (0.001))
+        .AddAttribute ("CacheFile",
+                       "File tables are loaded from and saved to, empty to disable caching",
+                       StringValue (""),
+                       MakeStringAccessor (&LookupErrorRateModel::m_cacheFile),
+                       MakeStringChecker ())
+        .AddAttribute ("AccuracyCheck",
+                       "Compare every lookup against the reference model",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&LookupErrorRateModel::m_accuracyCheck),
+                       MakeBooleanChecker ());
+
+        return tid;
+}
+
+LookupErrorRateModel::LookupErrorRateModel()
+    : m_minSnrDb (-10.0),
+      m_maxSnrDb (50.0),
+      m_snrStepDb (0.1),
+      m_accuracyCheck (false),
+      m_cacheLoaded (false),
+      m_cacheDirty (false),
+      m_nChecks (0),
+      m_maxAbsError (0),
+      m_sumAbsError (0)
+{
+    m_reference = CreateObject<NistErrorRateModel>();
+}
+
+LookupErrorRateModel::~LookupErrorRateModel()
+{}
+
+void
+LookupErrorRateModel::DoDispose (void)
+{
+    if(m_cacheDirty && !m_cacheFile.empty())
+    {
+        SaveCache();
+    }
+    if(m_accuracyCheck && m_nChecks > 0)
+    {
+        NS_LOG_INFO("[Accuracy] " << m_nChecks << " lookups, max abs error " << m_maxAbsError
+                    << ", mean abs error " << GetMeanAbsError());
+    }
+    m_reference = 0;
+    m_tables.clear();
+    m_cacheKeys.clear();
+    m_loaded.clear();
+    ErrorRateModel::DoDispose ();
+}
+
+void
+LookupErrorRateModel::SetReferenceModel(Ptr<ErrorRateModel> model)
+{
+    if(m_cacheDirty && !m_cacheFile.empty())
+    {
+        SaveCache();
+    }
+    m_reference = model;
+    /* tables sampled or loaded for the previous model are no longer valid */
+    m_tables.clear();
+    m_cacheKeys.clear();
+    m_loaded.clear();
+    m_cacheLoaded = false;
+}
+
+Ptr<ErrorRateModel>
+LookupErrorRateModel::GetReferenceModel()
+{
+    return m_reference;
+}
+
+uint8_t
+LookupErrorRateModel::GetBucket(uint64_t nbits)
+{
+    uint8_t bucket = 0;
+    while((nbits >> 1) > 0 && bucket < MAX_BUCKET)
+    {
+        nbits >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+uint64_t
+LookupErrorRateModel::GetKey(WifiMode mode, uint16_t channelWidth, uint8_t numRxAntennas, uint8_t bucket)
+{
+    return (static_cast<uint64_t>(mode.GetUid()) << 32)
+           | (static_cast<uint64_t>(channelWidth) << 16)
+           | (static_cast<uint64_t>(numRxAntennas) << 8)
+           | bucket;
+}
+
+std::string
+LookupErrorRateModel::GetCacheKey(WifiMode mode, uint16_t channelWidth, uint8_t numRxAntennas, uint8_t bucket) const
+{
+    std::ostringstream oss;
+    oss << m_reference->GetInstanceTypeId().GetName() << " " << mode.GetUniqueName() << " " << channelWidth << " " << +numRxAntennas << " " << +bucket;
+    return oss.str();
+}
+
+const std::vector<double>&
+LookupErrorRateModel::GetTable(WifiMode mode, const WifiTxVector& txVector, uint8_t numRxAntennas,
+                               uint8_t bucket) const
+{
+    uint16_t channelWidth = txVector.GetChannelWidth();
+    uint64_t key = GetKey(mode, channelWidth, numRxAntennas, bucket);
+    std::map<uint64_t, std::vector<double> >::const_iterator it = m_tables.find(key);
+    if(it != m_tables.end())
+    {
+        return it->second;
+    }
+
+    if(!m_cacheLoaded)
+    {
+        LoadCache();
+    }
+
+    std::string cacheKey = GetCacheKey(mode, channelWidth, numRxAntennas, bucket);
+    uint32_t nPoints = static_cast<uint32_t>(std::floor((m_maxSnrDb - m_minSnrDb) / m_snrStepDb)) + 1;
+    std::vector<double> &table = m_tables[key];
+    m_cacheKeys[key] = cacheKey;
+
+    std::map<std::string, std::vector<double> >::iterator loaded = m_loaded.find(cacheKey);
+    if(loaded != m_loaded.end() && loaded->second.size() == nPoints)
+    {
+        table.swap(loaded->second);
+        m_loaded.erase(loaded);
+        return table;
+    }
+
+    /* sample the reference model at the geometric middle of the bucket */
+    uint64_t nbits = static_cast<uint64_t>(std::floor(std::pow(2.0, bucket + 0.5)));
+    NS_LOG_DEBUG("[Build] " << cacheKey << ", " << nPoints << " SNR points");
+    table.resize(nPoints);
+    for(uint32_t i = 0; i < nPoints; i++)
+    {
+        double snrDb = m_minSnrDb + i * m_snrStepDb;
+        double snr = std::pow(10.0, snrDb / 10.0);
+        double csr = m_reference->GetChunkSuccessRate(mode, txVector, snr, nbits, numRxAntennas);
+        double bitLoss = -std::log(std::max(csr, 1e-300)) / nbits;
+        /* interpolating the log of the loss keeps the waterfall region accurate */
+        table[i] = std::log(std::max(bitLoss, MIN_BIT_LOSS));
+    }
+    m_cacheDirty = true;
+    return table;
+}
+
+double
+LookupErrorRateModel::DoGetChunkSuccessRate (WifiMode mode, const WifiTxVector& txVector, double snr,
+                                             uint64_t nbits, uint8_t numRxAntennas, WifiPpduField field,
+                                             uint16_t staId) const
+{
+    if(nbits == 0)
+    {
+        return 1.0;
+    }
+    const std::vector<double> &table = GetTable(mode, txVector, numRxAntennas, GetBucket(nbits));
+
+    /* linear interpolation over the SNR (dB) grid, clamped at both ends */
+    double snrDb = (snr > 0) ? 10.0 * std::log10(snr) : m_minSnrDb;
+    double pos = (snrDb - m_minSnrDb) / m_snrStepDb;
+    double logLoss;
+    if(pos <= 0)
+    {
+        logLoss = table.front();
+    }
+    else if(pos >= table.size() - 1)
+    {
+        logLoss = table.back();
+    }
+    else
+    {
+        uint32_t i = static_cast<uint32_t>(pos);
+        double frac = pos - i;
+        logLoss = table[i] + frac * (table[i + 1] - table[i]);
+    }
+    double csr = std::exp(-static_cast<double>(nbits) * std::exp(logLoss));
+
+    if(m_accuracyCheck)
+    {
+        double reference = m_reference->GetChunkSuccessRate(mode, txVector, snr, nbits, numRxAntennas, field, staId);
+        double error = std::fabs(csr - reference);
+        m_nChecks++;
+        m_sumAbsError += error;
+        if(error > m_maxAbsError)
+        {
+            m_maxAbsError = error;
+            NS_LOG_DEBUG("[Accuracy] " << mode << " snr " << snrDb << " dB, " << nbits << " bits: lookup "
+                         << csr << ", reference " << reference);
+        }
+    }
+    return csr;
+}
+
+void
+LookupErrorRateModel::Precompute(WifiMode mode, const WifiTxVector& txVector, uint8_t numRxAntennas)
+{
+    for(uint8_t bucket = 0; bucket <= MAX_BUCKET; bucket++)
+    {
+        GetTable(mode, txVector, numRxAntennas, bucket);
+    }
+}
+
+void
+LookupErrorRateModel::LoadCache() const
+{
+    m_cacheLoaded = true;
+    if(m_cacheFile.empty())
+    {
+        return;
+    }
+    std::ifstream file(m_cacheFile.c_str());
+    if(!file.is_open())
+    {
+        NS_LOG_INFO("[Cache] " << m_cacheFile << " not found, tables will be built");
+        return;
+    }
+
+    /* line format: reference mode width antennas bucket minSnr step nPoints values... */
+    std::string line;
+    while(std::getline(file, line))
+    {
+        if(line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::istringstream iss(line);
+        std::string reference, mode;
+        uint32_t width, antennas, bucket, nPoints;
+        double minSnr, step;
+        if(!(iss >> reference >> mode >> width >> antennas >> bucket >> minSnr >> step >> nPoints))
+        {
+            continue;
+        }
+        /* tables sampled on another grid are ignored */
+        if(std::fabs(minSnr - m_minSnrDb) > 1e-9 || std::fabs(step - m_snrStepDb) > 1e-9)
+        {
+            continue;
+        }
+        std::vector<double> table(nPoints);
+        for(uint32_t i = 0; i < nPoints; i++)
+        {
+            iss >> table[i];
+        }
+        if(!iss.fail())
+        {
+            std::ostringstream key;
+            key << reference << " " << mode << " " << width << " " << antennas << " " << bucket;
+            m_loaded[key.str()].swap(table);
+        }
+    }
+    NS_LOG_INFO("[Cache] loaded " << m_loaded.size() << " tables from " << m_cacheFile);
+}
+
+void
+LookupErrorRateModel::SaveCache()
+{
+    NS_ABORT_MSG_IF (m_cacheFile.empty(), "No cache file set");
+    std::ofstream file(m_cacheFile.c_str());
+    NS_ABORT_MSG_IF (!file.is_open(), "Cannot open " << m_cacheFile);
+    file.precision(17);
+    file << "# reference mode width antennas bucket minSnr step nPoints log(per-bit loss)..." << std::endl;
+
+    std::map<uint64_t, std::vector<double> >::const_iterator it;
+    for(it = m_tables.begin(); it != m_tables.end(); ++it)
+    {
+        file << m_cacheKeys[it->first] << " " << m_minSnrDb << " " << m_snrStepDb << " " << it->second.size();
+        for(std::vector<double>::const_iterator v = it->second.begin(); v != it->second.end(); ++v)
+        {
+            file << " " << *v;
+        }
+        file << std::endl;
+    }
+    /* keep tables that were loaded but not used in this run */
+    std::map<std::string, std::vector<double> >::const_iterator loaded;
+    for(loaded = m_loaded.begin(); loaded != m_loaded.end(); ++loaded)
+    {
+        file << loaded->first << " " << m_minSnrDb << " " << m_snrStepDb << " " << loaded->second.size();
+        for(std::vector<double>::const_iterator v = loaded->second.begin(); v != loaded->second.end(); ++v)
+        {
+            file << " " << *v;
+        }
+        file << std::endl;
+    }
+    m_cacheDirty = false;
+}
+
+uint32_t
+LookupErrorRateModel::GetNTables()
+{
+    return m_tables.size();
+}
+
+uint64_t
+LookupErrorRateModel::GetNChecks()
+{
+    return m_nChecks;
+}
+
+double
+LookupErrorRateModel::GetMaxAbsError()
+{
+    return m_maxAbsError;
+}
+
+double
+LookupErrorRateModel::GetMeanAbsError()
+{
+    if(m_nChecks == 0)
+    {
+        return 0;
+    }
+    return m_sumAbsError / m_nChecks;
+}
+
+}   /* ns3 */
+
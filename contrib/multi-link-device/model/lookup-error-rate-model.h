@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef LOOKUP_ERROR_RATE_MODEL_H
+#define LOOKUP_ERROR_RATE_MODEL_H
+
+#include "ns3/error-rate-model.h"
+#include "ns3/wifi-mode.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Table driven error rate model for fast PHY abstraction.
+ *
+ * Chunk success rates of a reference model (NistErrorRateModel by default)
+ * are sampled once over an SNR grid for every (mode, channel width, rx
+ * antennas, chunk length bucket) and interpolated at lookup. Chunk length
+ * buckets are powers of two; tables store the per-bit loss so that any
+ * length inside a bucket is served by the same table. Tables can be saved
+ * to and loaded from a cache file so they are only computed once.
+ */
+class LookupErrorRateModel : public ErrorRateModel
+{
+public:
+    static TypeId GetTypeId (void);
+
+    LookupErrorRateModel();
+    virtual ~LookupErrorRateModel();
+
+    /* set the model the tables are sampled from */
+    void SetReferenceModel(Ptr<ErrorRateModel> model);
+    /* get the model the tables are sampled from */
+    Ptr<ErrorRateModel> GetReferenceModel();
+    /* build the tables of every chunk length bucket of a mode at startup */
+    void Precompute(WifiMode mode, const WifiTxVector& txVector, uint8_t numRxAntennas = 1);
+    /* save every table to the cache file */
+    void SaveCache();
+    /* get number of tables currently held */
+    uint32_t GetNTables();
+    /* get number of lookups compared against the reference model (accuracy check mode) */
+    uint64_t GetNChecks();
+    /* get maximum absolute error seen in accuracy check mode */
+    double GetMaxAbsError();
+    /* get mean absolute error seen in accuracy check mode */
+    double GetMeanAbsError();
+
+    static const uint8_t MAX_BUCKET = 24;  // chunks up to 2^24 bits
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    virtual double DoGetChunkSuccessRate (WifiMode mode, const WifiTxVector& txVector, double snr,
+                                          uint64_t nbits, uint8_t numRxAntennas, WifiPpduField field,
+                                          uint16_t staId) const;
+
+    /* chunk length bucket of a number of bits */
+    static uint8_t GetBucket(uint64_t nbits);
+    /* runtime key of a table */
+    static uint64_t GetKey(WifiMode mode, uint16_t channelWidth, uint8_t numRxAntennas, uint8_t bucket);
+    /* cache file key of a table, prefixed with the reference model TypeId */
+    std::string GetCacheKey(WifiMode mode, uint16_t channelWidth, uint8_t numRxAntennas, uint8_t bucket) const;
+    /* get (and build if needed) the table of a key */
+    const std::vector<double>& GetTable(WifiMode mode, const WifiTxVector& txVector, uint8_t numRxAntennas,
+                                        uint8_t bucket) const;
+    /* load tables from the cache file */
+    void LoadCache() const;
+
+    double      m_minSnrDb;         // lowest SNR of the grid (dB)
+    double      m_maxSnrDb;         // highest SNR of the grid (dB)
+    double      m_snrStepDb;        // SNR grid step (dB)
+    std::string m_cacheFile;        // file the tables are loaded from and saved to
+    bool        m_accuracyCheck;    // compare every lookup against the reference model
+    Ptr<ErrorRateModel> m_reference;   // model the tables are sampled from
+
+    /* table: log of per-bit loss -ln(csr)/nbits at every SNR grid point */
+    mutable std::map<uint64_t, std::vector<double> > m_tables;             // tables by runtime key
+    mutable std::map<uint64_t, std::string> m_cacheKeys;                   // cache file key of built tables
+    mutable std::map<std::string, std::vector<double> > m_loaded;          // tables read from the cache file
+    mutable bool        m_cacheLoaded;      // whether the cache file has been read
+    mutable bool        m_cacheDirty;       // whether tables not in the cache file have been built
+    mutable uint64_t    m_nChecks;          // lookups compared in accuracy check mode
+    mutable double      m_maxAbsError;      // maximum absolute error in accuracy check mode
+    mutable double      m_sumAbsError;      // sum of absolute errors in accuracy check mode
+};
+
+}   /* ns3 */
+
+#endif /* LOOKUP_ERROR_RATE_MODEL_H */
@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/mld-sequence-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MldSequenceTag);
+
+TypeId
+MldSequenceTag::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::MldSequenceTag")
+        .SetParent<Tag> ()
+        .AddConstructor<MldSequenceTag> ();
+
+        return tid;
+}
+
+TypeId
+MldSequenceTag::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+MldSequenceTag::MldSequenceTag()
+    : m_source (0),
+      m_sequence (0),
+      m_timestamp (Seconds(0))
+{}
+
+MldSequenceTag::MldSequenceTag(uint32_t sequence, Time timestamp)
+    : m_source (0),
+      m_sequence (sequence),
+      m_timestamp (timestamp)
+{}
+
+void
+MldSequenceTag::SetSequence(uint32_t sequence)
+{
+    m_sequence = sequence;
+}
+
+uint32_t
+MldSequenceTag::GetSequence() const
+{
+    return m_sequence;
+}
+
+void
+MldSequenceTag::SetSource(uint32_t source)
+{
+    m_source = source;
+}
+
+uint32_t
+MldSequenceTag::GetSource() const
+{
+    return m_source;
+}
+
+void
+MldSequenceTag::SetTimestamp(Time timestamp)
+{
+    m_timestamp = timestamp;
+}
+
+Time
+MldSequenceTag::GetTimestamp() const
+{
+    return m_timestamp;
+}
+
+uint32_t
+MldSequenceTag::GetSerializedSize (void) const
+{
+    return 16;
+}
+
+void
+MldSequenceTag::Serialize (TagBuffer i) const
+{
+    i.WriteU32(m_source);
+    i.WriteU32(m_sequence);
+    i.WriteU64(m_timestamp.GetTimeStep());
+}
+
+void
+MldSequenceTag::Deserialize (TagBuffer i)
+{
+    m_source = i.ReadU32();
+    m_sequence = i.ReadU32();
+    m_timestamp = TimeStep(i.ReadU64());
+}
+
+void
+MldSequenceTag::Print (std::ostream &os) const
+{
+    os << "MldSource=" << m_source << " MldSeq=" << m_sequence << " Timestamp=" << m_timestamp;
+}
+
+}   /* ns3 */
+
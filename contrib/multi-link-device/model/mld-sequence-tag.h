@@ -0,0 +1,53 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef MLD_SEQUENCE_TAG_H
+#define MLD_SEQUENCE_TAG_H
+
+#include "ns3/tag.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/*
+ * MLD-level sequence number carried by every packet of a MultiLinkDevice.
+ * The sequence space is shared by both links, so a packet retransmitted on
+ * another link keeps its number and the receiver can drop duplicates. Every
+ * sender numbers its own packets, so the tag names the sender too (the node
+ * id of its MLD). The time the packet was generated is kept for latency
+ * across retransmissions.
+ */
+class MldSequenceTag : public Tag
+{
+public:
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    MldSequenceTag();
+    MldSequenceTag(uint32_t sequence, Time timestamp);
+
+    /* set the MLD sequence number */
+    void SetSequence(uint32_t sequence);
+    /* get the MLD sequence number */
+    uint32_t GetSequence() const;
+    /* set the sender of the sequence space */
+    void SetSource(uint32_t source);
+    /* get the sender of the sequence space */
+    uint32_t GetSource() const;
+    /* set the time the packet was generated */
+    void SetTimestamp(Time timestamp);
+    /* get the time the packet was generated */
+    Time GetTimestamp() const;
+
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (TagBuffer i) const;
+    virtual void Deserialize (TagBuffer i);
+    virtual void Print (std::ostream &os) const;
+
+private:
+    uint32_t    m_source;       // node id of the sending MLD
+    uint32_t    m_sequence;     // MLD sequence number
+    Time        m_timestamp;    // time the packet was generated
+};
+
+}   /* ns3 */
+
+#endif /* MLD_SEQUENCE_TAG_H */
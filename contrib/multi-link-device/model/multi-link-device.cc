@@ -2,6 +2,12 @@
 
 #include "ns3/multi-link-device.h"
 #include "ns3/nstime.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-phy-state-helper.h"
+#include "ns3/wifi-mac.h"
+#include "ns3/wifi-mac-queue.h"
+#include "ns3/qos-utils.h"
+#include "ns3/node.h"
 
 namespace ns3 {
 
@@ -13,7 +19,19 @@ TypeId
 MultiLinkDevice::GetTypeId (void)
 {
     static TypeId tid = TypeId ("ns3::MultiLinkDevice")
-        .SetParent<Object> ();
+        .SetParent<Object> ()
+        .AddTraceSource ("LinkState",
+                         "A period a link spent in a state, transition delays being SWITCHING",
+                         MakeTraceSourceAccessor (&MultiLinkDevice::m_linkStateTrace),
+                         "ns3::MultiLinkDevice::LinkStateTracedCallback")
+        .AddTraceSource ("Tx",
+                         "A new packet generated for the peer MLD, retransmissions excluded",
+                         MakeTraceSourceAccessor (&MultiLinkDevice::m_txTrace),
+                         "ns3::Packet::TracedCallback")
+        .AddTraceSource ("Rx",
+                         "A packet received from the peer MLD, duplicates excluded, with its latency",
+                         MakeTraceSourceAccessor (&MultiLinkDevice::m_rxTrace),
+                         "ns3::MultiLinkDevice::RxTracedCallback");
 
         return tid;
 }
@@ -32,8 +50,15 @@ MultiLinkDevice::MultiLinkDevice()
       m_residualBits (0),
       m_lastStartTime (Seconds(0)),
       m_unsentPacket (0),
-      m_isAP (true)
-      
+      m_isAP (true),
+      m_sleepInactive (false),
+      m_direct (false),
+      m_nextSequence (0),
+      m_retransmissions (0),
+      m_duplicates (0),
+      m_tooOld (0),
+      m_retxLost (0)
+
 {
 
 }
@@ -46,6 +71,7 @@ MultiLinkDevice::SetSTA1(const NetDeviceContainer device)
 {
     Ptr<WifiNetDevice> wd = DynamicCast<WifiNetDevice>(device.Get(0));
     m_sta1 = wd;
+    ConnectLinkState(0);
 }
 
 Ptr<WifiNetDevice>
@@ -59,6 +85,7 @@ MultiLinkDevice::SetSTA2(const NetDeviceContainer device)
 {
     Ptr<WifiNetDevice> wd = DynamicCast<WifiNetDevice>(device.Get(0));
     m_sta2 = wd;
+    ConnectLinkState(1);
 }
 
 Ptr<WifiNetDevice>
@@ -85,10 +112,24 @@ MultiLinkDevice::GetTotalByte()
     return m_totalByte;
 }
 
+uint32_t 
+MultiLinkDevice::GetTotalReceive()
+{
+    return m_totalReceive;
+}
+
+uint32_t
+MultiLinkDevice::GetPacketSize()
+{
+    return m_packetSize;
+}
+
 void 
 MultiLinkDevice::Clear()
 {
     m_isTransit = false;
+    /* packets left behind by the old link go out first on the new one */
+    SendRetransmissions();
 }
 
 void 
@@ -121,6 +162,226 @@ MultiLinkDevice::GetSendError()
     return m_SendError;
 }
 
+void
+MultiLinkDevice::SetSleepInactiveLink(bool enable)
+{
+    m_sleepInactive = enable;
+}
+
+uint32_t
+MultiLinkDevice::GetRetransmissions()
+{
+    return m_retransmissions;
+}
+
+uint32_t
+MultiLinkDevice::GetDuplicates()
+{
+    return m_duplicates;
+}
+
+uint32_t
+MultiLinkDevice::GetTooOld()
+{
+    return m_tooOld;
+}
+
+uint32_t
+MultiLinkDevice::GetRetransmissionsLost()
+{
+    return m_retxLost;
+}
+
+bool
+MultiLinkDevice::GetSleepInactiveLink()
+{
+    return m_sleepInactive;
+}
+
+void
+MultiLinkDevice::ConnectLinkState(uint32_t link)
+{
+    for(uint32_t state = 0; state < AIRTIME_STATES; state++)
+    {
+        m_airtime[link][state] = Seconds(0);
+    }
+    m_lastStateEnd[link] = Simulator::Now();
+    m_transitWindows[link].clear();
+    Ptr<WifiPhyStateHelper> phyState = GetLinkDevice(link)->GetPhy()->GetState();
+    if(link == 0)
+    {
+        phyState->TraceConnectWithoutContext("State", MakeCallback(&MultiLinkDevice::NotifyStateLink1, this));
+    }
+    else
+    {
+        phyState->TraceConnectWithoutContext("State", MakeCallback(&MultiLinkDevice::NotifyStateLink2, this));
+    }
+}
+
+void
+MultiLinkDevice::NotifyStateLink1(Time start, Time duration, WifiPhyState state)
+{
+    NotifyLinkState(0, start, duration, state);
+}
+
+void
+MultiLinkDevice::NotifyStateLink2(Time start, Time duration, WifiPhyState state)
+{
+    NotifyLinkState(1, start, duration, state);
+}
+
+/* airtime state of a PHY state, an OFF PHY is accounted as sleeping */
+static MultiLinkDevice::AirtimeState
+ToAirtimeState(WifiPhyState state)
+{
+    switch(state)
+    {
+    case WifiPhyState::CCA_BUSY:
+        return MultiLinkDevice::AIRTIME_CCA_BUSY;
+    case WifiPhyState::TX:
+        return MultiLinkDevice::AIRTIME_TX;
+    case WifiPhyState::RX:
+        return MultiLinkDevice::AIRTIME_RX;
+    case WifiPhyState::SWITCHING:
+        return MultiLinkDevice::AIRTIME_PHY_SWITCHING;
+    case WifiPhyState::SLEEP:
+    case WifiPhyState::OFF:
+        return MultiLinkDevice::AIRTIME_SLEEP;
+    default:
+        return MultiLinkDevice::AIRTIME_IDLE;
+    }
+}
+
+Time
+MultiLinkDevice::GetSwitchingOverlap(uint32_t link, Time start, Time end)
+{
+    Time overlap = Seconds(0);
+    for(std::deque<std::pair<Time, Time> >::iterator it = m_transitWindows[link].begin();
+        it != m_transitWindows[link].end() && it->first < end; ++it)
+    {
+        if(it->second > start)
+        {
+            overlap += Min(end, it->second) - Max(start, it->first);
+        }
+    }
+    return overlap;
+}
+
+void
+MultiLinkDevice::NotifyLinkState(uint32_t link, Time start, Time duration, WifiPhyState state)
+{
+    Time end = start + duration;
+    /* periods are reported in order: transitions over before this one will not be overlapped again */
+    std::deque<std::pair<Time, Time> > &windows = m_transitWindows[link];
+    while(!windows.empty() && windows.front().second <= start)
+    {
+        windows.pop_front();
+    }
+    AirtimeState airtime = ToAirtimeState(state);
+    Time active = duration - GetSwitchingOverlap(link, start, end);
+    m_airtime[link][airtime] += active;
+    m_lastStateEnd[link] = Max(m_lastStateEnd[link], end);
+    m_linkStateTrace(link, start, active, airtime);
+}
+
+Time
+MultiLinkDevice::GetAirtime(uint32_t link, AirtimeState state)
+{
+    NS_ASSERT (link < 2 && state < AIRTIME_STATES);
+    Time airtime = m_airtime[link][state];
+    Time now = Simulator::Now();
+    if(state == AIRTIME_SWITCHING)
+    {
+        /* transitions are credited as a whole when they start: leave out what is still to come */
+        for(std::deque<std::pair<Time, Time> >::iterator it = m_transitWindows[link].begin();
+            it != m_transitWindows[link].end(); ++it)
+        {
+            if(it->second > now)
+            {
+                airtime -= it->second - Max(now, it->first);
+            }
+        }
+    }
+    /* the ongoing PHY state is only reported when it ends */
+    Ptr<WifiNetDevice> device = GetLinkDevice(link);
+    if(device != 0 && ToAirtimeState(device->GetPhy()->GetState()->GetState()) == state)
+    {
+        airtime += (now - m_lastStateEnd[link]) - GetSwitchingOverlap(link, m_lastStateEnd[link], now);
+    }
+    return airtime;
+}
+
+std::string
+MultiLinkDevice::GetAirtimeStateName(AirtimeState state)
+{
+    static const char *names[AIRTIME_STATES] = { "IDLE", "CCA_BUSY", "TX", "RX", "SWITCHING", "SLEEP", "PHY_SWITCHING" };
+    return (state < AIRTIME_STATES)? names[state] : "UNKNOWN";
+}
+
+uint64_t
+MultiLinkDevice::GetMemoryUsage()
+{
+    uint64_t bytes = sizeof(*this) + m_retxQueue.size() * sizeof(MldSequenceTag);
+    /* a map node holds the key and the window besides its tree links */
+    bytes += m_rxWindows.size() * (sizeof(std::pair<const uint32_t, RxWindow>) + 4 * sizeof(void *));
+    if(m_unsentPacket)
+    {
+        bytes += sizeof(Packet) + m_unsentPacket->GetSize();
+    }
+    Ptr<Socket> sockets[2] = { m_socket1, m_socket2 };
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        if(sockets[i])
+        {
+            bytes += sockets[i]->GetInstanceTypeId().GetSize();
+        }
+    }
+    return bytes;
+}
+
+Ptr<WifiNetDevice>
+MultiLinkDevice::GetLinkDevice(uint32_t link)
+{
+    return (link == 0)? m_sta1 : m_sta2;
+}
+
+void
+MultiLinkDevice::SleepLink(uint32_t link)
+{
+    /* the link may have become active again while waiting */
+    if(link == m_linkNumber)
+    {
+        return;
+    }
+    Ptr<WifiPhy> phy = GetLinkDevice(link)->GetPhy();
+    if(phy->IsStateSleep())
+    {
+        return;
+    }
+    /* let an ongoing transmission/reception end before sleeping, WifiPhy would otherwise
+       postpone the sleep on its own and could put the link to sleep after it is woken up */
+    if(phy->IsStateTx() || phy->IsStateRx() || phy->IsStateSwitching())
+    {
+        Time delay = Max(phy->GetDelayUntilIdle(), MicroSeconds(1));
+        m_sleepEvent[link] = Simulator::Schedule(delay, &MultiLinkDevice::SleepLink, this, link);
+        return;
+    }
+    NS_LOG_INFO("[Sleep] link " << link);
+    phy->SetSleepMode();
+}
+
+void
+MultiLinkDevice::WakeLink(uint32_t link)
+{
+    m_sleepEvent[link].Cancel();
+    Ptr<WifiPhy> phy = GetLinkDevice(link)->GetPhy();
+    if(phy->IsStateSleep())
+    {
+        NS_LOG_INFO("[Wake] link " << link);
+        phy->ResumeFromSleep();
+    }
+}
+
 void 
 MultiLinkDevice::SocketSetting(Ptr<Socket> socket1, Ptr<Socket> socket2, Address addr1, Address addr2, DataRate cbrRate, bool isAP)
 {
@@ -131,15 +392,210 @@ MultiLinkDevice::SocketSetting(Ptr<Socket> socket1, Ptr<Socket> socket2, Address
     m_cbrRate = cbrRate;
     m_isAP = isAP;
 
+    StartTx();
+}
+
+void 
+MultiLinkDevice::DirectSetting(Address peer1, Address peer2, DataRate cbrRate, bool isAP)
+{
+    m_direct = true;
+    m_peer1 = peer1;
+    m_peer2 = peer2;
+    m_cbrRate = cbrRate;
+    m_isAP = isAP;
+
+    /* count packets of the peer MLD on both links, next to the IP stack if any */
+    m_sta1->GetNode()->RegisterProtocolHandler(MakeCallback(&MultiLinkDevice::ReceivePacket, this), PROT_NUMBER, m_sta1);
+    m_sta2->GetNode()->RegisterProtocolHandler(MakeCallback(&MultiLinkDevice::ReceivePacket, this), PROT_NUMBER, m_sta2);
+
+    StartTx();
+}
 
+void 
+MultiLinkDevice::StartTx()
+{
     /* if this device is STA => start to transmit packets*/
     if(m_isAP == false)
     {
+        /* packets the MAC gives up on are sent again on whichever link is active: MacTxDrop only
+           covers packets refused by the queue, MPDUs failing their last retry are DroppedMpdu.
+           A given up MPDU may have been received (lost ACK), only the peer MLD of the direct
+           mode drops the duplicates, a socket receiver would count them */
+        if(m_direct)
+        {
+            m_sta1->GetMac()->TraceConnectWithoutContext("MacTxDrop", MakeCallback(&MultiLinkDevice::NotifyTxDrop, this));
+            m_sta2->GetMac()->TraceConnectWithoutContext("MacTxDrop", MakeCallback(&MultiLinkDevice::NotifyTxDrop, this));
+            m_sta1->GetMac()->TraceConnectWithoutContext("DroppedMpdu", MakeCallback(&MultiLinkDevice::NotifyDroppedMpdu, this));
+            m_sta2->GetMac()->TraceConnectWithoutContext("DroppedMpdu", MakeCallback(&MultiLinkDevice::NotifyDroppedMpdu, this));
+        }
+        /* a single radio only listens on the active link */
+        if(m_sleepInactive)
+        {
+            SleepLink((m_linkNumber == 0)? 1 : 0);
+        }
         Simulator::Schedule(m_transitFreq, &MultiLinkDevice::SwitchLink, this);
         Simulator::ScheduleNow (&MultiLinkDevice::SchduleNextTx, this);
     }
 }
 
+void 
+MultiLinkDevice::ReceivePacket(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                               const Address &from, const Address &to, NetDevice::PacketType packetType)
+{
+    if(Receive(packet))
+    {
+        m_totalReceive++;
+        MldSequenceTag tag;
+        Time latency = packet->PeekPacketTag(tag)? Simulator::Now() - tag.GetTimestamp() : Seconds(0);
+        m_rxTrace(packet, latency);
+    }
+}
+
+bool
+MultiLinkDevice::Receive(Ptr<const Packet> packet)
+{
+    MldSequenceTag tag;
+    if(!packet->PeekPacketTag(tag))
+    {
+        return true;
+    }
+    uint32_t seq = tag.GetSequence();
+    std::map<uint32_t, RxWindow>::iterator it = m_rxWindows.find(tag.GetSource());
+    if(it == m_rxWindows.end())
+    {
+        RxWindow &window = m_rxWindows[tag.GetSource()];
+        window.highest = seq;
+        window.received.set(seq % RX_WINDOW);
+        return true;
+    }
+    RxWindow &window = it->second;
+    if(seq > window.highest)
+    {
+        /* slide the window, forgetting the sequence numbers that fall out of it */
+        if(seq - window.highest >= RX_WINDOW)
+        {
+            window.received.reset();
+        }
+        else
+        {
+            for(uint32_t s = window.highest + 1; s < seq; s++)
+            {
+                window.received.reset(s % RX_WINDOW);
+            }
+        }
+        window.highest = seq;
+        window.received.set(seq % RX_WINDOW);
+        return true;
+    }
+    /* too old to be told apart from a duplicate: possibly a first delivery, e.g. a late retransmission */
+    if(window.highest - seq >= RX_WINDOW)
+    {
+        NS_LOG_INFO("[Receive] MLD sequence " << seq << " of node " << tag.GetSource() << " older than the window");
+        m_tooOld++;
+        return false;
+    }
+    if(window.received.test(seq % RX_WINDOW))
+    {
+        NS_LOG_INFO("[Receive] duplicate MLD sequence " << seq << " of node " << tag.GetSource());
+        m_duplicates++;
+        return false;
+    }
+    window.received.set(seq % RX_WINDOW);
+    return true;
+}
+
+void
+MultiLinkDevice::NotifyTxDrop(Ptr<const Packet> packet)
+{
+    MldSequenceTag tag;
+    if(packet->PeekPacketTag(tag))
+    {
+        NS_LOG_INFO("[Drop] MLD sequence " << tag.GetSequence() << " dropped by the MAC");
+        QueueRetransmission(tag);
+    }
+}
+
+void
+MultiLinkDevice::NotifyDroppedMpdu(WifiMacDropReason reason, Ptr<const WifiMacQueueItem> mpdu)
+{
+    MldSequenceTag tag;
+    if(mpdu->GetPacket()->PeekPacketTag(tag))
+    {
+        NS_LOG_INFO("[Drop] MLD sequence " << tag.GetSequence() << " given up by the MAC, reason " << reason);
+        QueueRetransmission(tag);
+    }
+}
+
+void
+MultiLinkDevice::QueueRetransmission(const MldSequenceTag &tag)
+{
+    if(m_retxQueue.size() >= MAX_RETX)
+    {
+        NS_LOG_WARN("[Retransmit] queue full, MLD sequence " << m_retxQueue.front().GetSequence() << " is lost");
+        m_retxQueue.pop_front();
+        m_retxLost++;
+    }
+    m_retxQueue.push_back(tag);
+}
+
+void
+MultiLinkDevice::CollectStranded(uint32_t link)
+{
+    /* only the direct mode knows the peer of each link, the IP route of a socket is bound to its STA */
+    if(!m_direct)
+    {
+        return;
+    }
+    Ptr<WifiMacQueue> queue = GetLinkDevice(link)->GetMac()->GetTxopQueue(AC_BE);
+    Mac48Address peer = Mac48Address::ConvertFrom((link == 0)? m_peer1 : m_peer2);
+    MldSequenceTag tag;
+    WifiMacQueue::ConstIterator it = queue->PeekByAddress(peer);
+    while(it != WifiMacQueue::EMPTY)
+    {
+        /* an MPDU sent at least once is awaiting its acknowledgment or retried by the MAC,
+           which reports it through DroppedMpdu if it gives up: leave it to the MAC */
+        if((*it)->IsInFlight() || (*it)->GetHeader().IsRetry() || !(*it)->GetPacket()->PeekPacketTag(tag))
+        {
+            it = queue->PeekByAddress(peer, ++it);
+            continue;
+        }
+        QueueRetransmission(tag);
+        it = queue->PeekByAddress(peer, queue->Remove(it));
+    }
+}
+
+void
+MultiLinkDevice::SendRetransmissions()
+{
+    while(!m_retxQueue.empty() && !m_isTransit)
+    {
+        Ptr<Packet> packet = Create<Packet> (m_packetSize);
+        packet->AddPacketTag(m_retxQueue.front());
+        if(SendOnActiveLink(packet) != (int) m_packetSize)
+        {
+            /* the active link is full, try again at the next transmission */
+            return;
+        }
+        m_retxQueue.pop_front();
+        m_retransmissions++;
+    }
+}
+
+int
+MultiLinkDevice::SendOnActiveLink(Ptr<Packet> packet)
+{
+    if(m_direct)
+    {
+        /* hand the packet straight to the STA, WifiNetDevice only adds the LLC/SNAP header */
+        Address peer = (m_linkNumber == 0)? m_peer1 : m_peer2;
+        bool sent = GetLinkDevice(m_linkNumber)->Send(packet, peer, PROT_NUMBER);
+        return sent? m_packetSize : -1;
+    }
+    /* decide use which STA(socket) to sned packet  */
+    Ptr<Socket> socket = (m_linkNumber == 0)? m_socket1 : m_socket2;
+    return socket->Send(packet);
+}
+
 void 
 MultiLinkDevice::SchduleNextTx()
 {
@@ -164,7 +620,9 @@ MultiLinkDevice::SendPacket ()
         return;
     }
 
-    Ptr<Socket> socket;
+    /* retransmissions are older than any new packet */
+    SendRetransmissions();
+
     Ptr<Packet> packet;
     /* see whether have unsent packet */
     if(m_unsentPacket)
@@ -173,12 +631,15 @@ MultiLinkDevice::SendPacket ()
     }
     else
     {
+        /* every new packet takes the next number of the sequence space shared by both links */
         packet = Create<Packet> (m_packetSize);
+        MldSequenceTag tag (m_nextSequence++, Simulator::Now());
+        tag.SetSource(m_sta1->GetNode()->GetId());
+        packet->AddPacketTag(tag);
+        m_txTrace(packet);
     }
 
-    /* decide use which STA(socket) to sned packet  */
-    socket = (m_linkNumber == 0)? m_socket1 : m_socket2;
-    int actual = socket->Send(packet);
+    int actual = SendOnActiveLink(packet);
     /* check how many data have been successfully transmitted */
     if((unsigned) actual == m_packetSize)
     {
@@ -202,6 +663,7 @@ MultiLinkDevice::SwitchLink()
     NS_LOG_INFO("[ Transiting... ]");
     /* change the state of this device */
     m_isTransit = true;
+    uint32_t oldLink = m_linkNumber;
     /* switch link */
     if(m_linkNumber == 0)
     {
@@ -211,6 +673,21 @@ MultiLinkDevice::SwitchLink()
     {
         m_linkNumber = 0;
     }
+    /* the radio leaves the old link and wakes up on the new one at the start of the
+       transition, so the wakeup is covered by the transition delay */
+    /* the transition delay is airtime of the new link, whatever its PHY reports meanwhile,
+       credited when the transition starts, GetAirtime leaving out the part not elapsed yet */
+    Time now = Simulator::Now();
+    m_transitWindows[m_linkNumber].push_back(std::make_pair(now, now + m_transitDelay));
+    m_airtime[m_linkNumber][AIRTIME_SWITCHING] += m_transitDelay;
+    m_linkStateTrace(m_linkNumber, now, m_transitDelay, AIRTIME_SWITCHING);
+    /* packets still queued on the old link would wait a whole period, resend them on the new link */
+    CollectStranded(oldLink);
+    if(m_sleepInactive)
+    {
+        SleepLink(oldLink);
+        WakeLink(m_linkNumber);
+    }
     /* clear the transit flag after tansition delay */
     Simulator::Schedule(m_transitDelay, &MultiLinkDevice::Clear, this);
     /* switch link every transit frequency */
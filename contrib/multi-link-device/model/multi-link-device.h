@@ -7,6 +7,17 @@
 #include "ns3/object.h"
 #include "ns3/socket.h"
 #include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
+#include "ns3/wifi-phy-state.h"
+#include "ns3/wifi-mac.h"
+#include "ns3/wifi-mac-queue-item.h"
+#include "ns3/mld-sequence-tag.h"
+
+#include <bitset>
+#include <deque>
+#include <map>
+#include <utility>
 
 namespace ns3 {
 
@@ -15,6 +26,24 @@ class MultiLinkDevice : public Object
 public:
     static TypeId GetTypeId (void);
 
+    /* states a link spends its airtime in, SWITCHING covering the eMLSR transition delays and
+       PHY_SWITCHING the channel switches of the PHY itself outside of them */
+    enum AirtimeState
+    {
+        AIRTIME_IDLE = 0,
+        AIRTIME_CCA_BUSY,
+        AIRTIME_TX,
+        AIRTIME_RX,
+        AIRTIME_SWITCHING,
+        AIRTIME_SLEEP,
+        AIRTIME_PHY_SWITCHING,
+        AIRTIME_STATES
+    };
+    /* signature of the LinkState trace: link, start, duration and state of a period */
+    typedef void (* LinkStateTracedCallback)(uint32_t link, Time start, Time duration, AirtimeState state);
+    /* signature of the Rx trace: packet received from the peer MLD and its latency since generation */
+    typedef void (* RxTracedCallback)(Ptr<const Packet> packet, Time latency);
+
     MultiLinkDevice();
     virtual ~MultiLinkDevice();
     
@@ -32,6 +61,10 @@ public:
     Address GetAddress2();
     /* show how many packet have been sent */
     uint32_t GetTotalByte();
+    /* show how many packet have been received */
+    uint32_t GetTotalReceive();
+    /* get size (bytes) of the packets sent by the CBR source */
+    uint32_t GetPacketSize();
     /* clear the transiting state */
     void Clear();  
     /* transition delay setting */
@@ -44,8 +77,39 @@ public:
     Time GetTransitFreq();
     /* get total sending error number */
     uint32_t GetSendError();
+    /* get number of packets retransmitted after being dropped or stranded on a link */
+    uint32_t GetRetransmissions();
+    /* get number of duplicate packets dropped at reception */
+    uint32_t GetDuplicates();
+    /* get number of packets dropped at reception for being older than the duplicate detection window */
+    uint32_t GetTooOld();
+    /* get number of pending retransmissions given up because MAX_RETX were already waiting */
+    uint32_t GetRetransmissionsLost();
+    /* put the PHY of the inactive eMLSR link to sleep or not */
+    void SetSleepInactiveLink(bool enable);
+    /* see whether the PHY of the inactive eMLSR link is put to sleep */
+    bool GetSleepInactiveLink();
+    /* get the time a link (0 or 1) spent in a state, up to now */
+    Time GetAirtime(uint32_t link, AirtimeState state);
+    /* get the name of an airtime state */
+    static std::string GetAirtimeStateName(AirtimeState state);
+    /* estimated memory (bytes) held by the MLD itself: its sockets, cached and retransmission packets */
+    uint64_t GetMemoryUsage();
     /* create and bind socket */
     void SocketSetting(Ptr<Socket> socket1, Ptr<Socket> socket2, Address addr1, Address addr2, DataRate cbrRate, bool isAP); 
+    /* send directly to the peer STAs(MAC address) of each link, bypassing UDP/IP */
+    void DirectSetting(Address peer1, Address peer2, DataRate cbrRate, bool isAP);
+    /* receive packets sent directly by the peer MLD */
+    void ReceivePacket(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                       const Address &from, const Address &to, NetDevice::PacketType packetType);
+    /* a packet was dropped by the MAC of a link, retransmit it (direct mode) */
+    void NotifyTxDrop(Ptr<const Packet> packet);
+    /* an MPDU was given up by the MAC of a link (retry limit, lifetime...), retransmit its packet (direct mode) */
+    void NotifyDroppedMpdu(WifiMacDropReason reason, Ptr<const WifiMacQueueItem> mpdu);
+
+    static const uint16_t PROT_NUMBER = 0x88B5;   // EtherType of packets sent directly on the links
+    static const uint32_t RX_WINDOW = 1024;        // sequence numbers tracked for duplicate detection
+    static const uint32_t MAX_RETX = 1024;         // retransmissions waiting at most
 
 
     /* schedule the next packet transmission */
@@ -56,6 +120,43 @@ public:
     void SwitchLink();
 
 private:
+    /* start the eMLSR link switching and the CBR traffic of a STA */
+    void StartTx();
+    /* get the STA(WifiNetDevice) of a link */
+    Ptr<WifiNetDevice> GetLinkDevice(uint32_t link);
+    /* put the PHY of an inactive link to sleep once it is done transmitting/receiving */
+    void SleepLink(uint32_t link);
+    /* wake the PHY of a link up */
+    void WakeLink(uint32_t link);
+    /* send a packet on the active link, return the number of bytes accepted */
+    int SendOnActiveLink(Ptr<Packet> packet);
+    /* queue the MLD sequence number (and generation time) of a packet for retransmission */
+    void QueueRetransmission(const MldSequenceTag &tag);
+    /* move the packets stranded in the MAC queue of an inactive link, never transmitted yet, to the retransmission queue */
+    void CollectStranded(uint32_t link);
+    /* send every queued retransmission on the active link */
+    void SendRetransmissions();
+    /* count a received packet, return false if it is a duplicate of its sender */
+    bool Receive(Ptr<const Packet> packet);
+    /* subscribe to the PHY state changes of a link */
+    void ConnectLinkState(uint32_t link);
+    /* PHY state period of link 1 */
+    void NotifyStateLink1(Time start, Time duration, WifiPhyState state);
+    /* PHY state period of link 2 */
+    void NotifyStateLink2(Time start, Time duration, WifiPhyState state);
+    /* account a PHY state period of a link, the part within transition delays being SWITCHING */
+    void NotifyLinkState(uint32_t link, Time start, Time duration, WifiPhyState state);
+    /* time of [start, end) within the transition delays of a link */
+    Time GetSwitchingOverlap(uint32_t link, Time start, Time end);
+
+private:
+    /* sequence numbers received from one sender */
+    struct RxWindow
+    {
+        uint32_t    highest;       // highest sequence number received
+        std::bitset<RX_WINDOW> received;    // received sequence numbers, indexed modulo RX_WINDOW
+    };
+
     uint32_t    m_totalByte;       // total packet number that have been sent
     uint32_t    m_totalReceive;    // total packet number that have been received
     uint32_t    m_linkNumber;      // the eMLSR link that transmitting now
@@ -69,6 +170,24 @@ private:
     Time        m_lastStartTime;   // time last packet sent
     Ptr<Packet> m_unsentPacket;    // unsent packet cached for future attempt
     bool        m_isAP;            // see this device is AP or not
+    bool        m_sleepInactive;   // put the PHY of the inactive link to sleep
+    bool        m_direct;          // send directly through the STAs instead of the sockets
+    Address     m_peer1;           // peer address of STA1 in direct mode
+    Address     m_peer2;           // peer address of STA2 in direct mode
+    EventId     m_sleepEvent[2];   // pending sleep of each link, waiting for its PHY to be idle
+    uint32_t    m_nextSequence;    // MLD sequence number of the next new packet
+    std::deque<MldSequenceTag> m_retxQueue;   // sequence numbers waiting for retransmission
+    uint32_t    m_retransmissions; // total retransmitted packet number
+    std::map<uint32_t, RxWindow> m_rxWindows; // duplicate detection of every sender
+    uint32_t    m_duplicates;      // total duplicate packet number dropped at reception
+    uint32_t    m_tooOld;          // total packet number dropped at reception, too old to be told apart from duplicates
+    uint32_t    m_retxLost;        // total retransmissions given up on a full retransmission queue
+    Time        m_airtime[2][AIRTIME_STATES];   // time spent by each link in each state
+    Time        m_lastStateEnd[2]; // end of the last PHY state period reported by each link
+    std::deque<std::pair<Time, Time> > m_transitWindows[2];   // transition delays not yet covered by PHY periods
+    TracedCallback<uint32_t, Time, Time, AirtimeState> m_linkStateTrace;   // airtime periods of the links
+    TracedCallback<Ptr<const Packet> > m_txTrace;           // new packets generated
+    TracedCallback<Ptr<const Packet>, Time> m_rxTrace;    // packets received, without duplicates
 
     Ptr<Socket> m_socket1;       // socket of STA1
     Ptr<Socket> m_socket2;       // socket of STA2
@@ -0,0 +1,304 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/spectrum-occupancy-sink.h"
+#include "ns3/non-communicating-net-device.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("SpectrumOccupancySink");
+
+NS_OBJECT_ENSURE_REGISTERED (SpectrumOccupancySink);
+
+TypeId
+SpectrumOccupancySink::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::SpectrumOccupancySink")
+        .SetParent<Object> ()
+        .AddConstructor<SpectrumOccupancySink> ()
+        .AddAttribute ("Threshold",
+                       "Energy (dBm) above which a subband is considered busy",
+                       DoubleValue (-62.0),
+                       MakeDoubleAccessor (&SpectrumOccupancySink::SetThreshold,
+                                           &SpectrumOccupancySink::GetThreshold),
+                       MakeDoubleChecker<double> ());
+
+        return tid;
+}
+
+SpectrumOccupancySink::SpectrumOccupancySink()
+    : m_thresholdDbm (-62.0),
+      m_thresholdW (std::pow(10.0, (-62.0 - 30.0) / 10.0)),
+      m_samples (0),
+      m_firstSample (Seconds(0)),
+      m_lastSample (Seconds(0)),
+      m_modelUid (0)
+{
+
+}
+
+SpectrumOccupancySink::~SpectrumOccupancySink()
+{}
+
+void
+SpectrumOccupancySink::DoDispose (void)
+{
+    m_subbands.clear();
+    m_binWidth.clear();
+    Object::DoDispose ();
+}
+
+uint32_t
+SpectrumOccupancySink::AddSubband(std::string name, double fLow, double fHigh)
+{
+    NS_ABORT_MSG_IF (m_samples > 0, "Subbands must be added before the first PSD sample");
+    NS_ABORT_MSG_IF (fHigh <= fLow, "Invalid subband [" << fLow << ", " << fHigh << "]");
+
+    Subband subband;
+    subband.name = name;
+    subband.fLow = fLow;
+    subband.fHigh = fHigh;
+    subband.firstBin = 0;
+    subband.lastBin = 0;
+    subband.busy = 0;
+    subband.maxPowerW = 0;
+    for(uint32_t i = 0; i < POWER_HISTOGRAM_BINS; i++)
+    {
+        subband.powerHistogram[i] = 0;
+    }
+    m_subbands.push_back(subband);
+
+    /* counters are sized once here so that reducing samples never allocates */
+    uint32_t n = m_subbands.size();
+    m_nBusy.assign(n + 1, 0);
+    m_pairBusy.assign(n * n, 0);
+    m_isBusy.assign(n, 0);
+    /* force bin ranges to be resolved again */
+    m_modelUid = 0;
+
+    return n - 1;
+}
+
+uint32_t
+SpectrumOccupancySink::GetNSubbands()
+{
+    return m_subbands.size();
+}
+
+void
+SpectrumOccupancySink::SetThreshold(double thresholdDbm)
+{
+    m_thresholdDbm = thresholdDbm;
+    m_thresholdW = std::pow(10.0, (thresholdDbm - 30.0) / 10.0);
+}
+
+double
+SpectrumOccupancySink::GetThreshold()
+{
+    return m_thresholdDbm;
+}
+
+void
+SpectrumOccupancySink::ConnectToAnalyzer(Ptr<NetDevice> analyzerDevice)
+{
+    Ptr<NonCommunicatingNetDevice> device = DynamicCast<NonCommunicatingNetDevice>(analyzerDevice);
+    NS_ABORT_MSG_IF (device == 0, "Device is not a spectrum analyzer device");
+    bool connected = device->GetPhy()->TraceConnectWithoutContext("AveragePowerSpectralDensityReport",
+                                                                   MakeCallback(&SpectrumOccupancySink::ReportPsd, this));
+    NS_ABORT_MSG_IF (!connected, "Device PHY has no AveragePowerSpectralDensityReport trace source");
+}
+
+void
+SpectrumOccupancySink::ResolveBins(Ptr<const SpectrumModel> model)
+{
+    m_binWidth.clear();
+    m_binWidth.reserve(model->GetNumBands());
+    for(Bands::const_iterator it = model->Begin(); it != model->End(); ++it)
+    {
+        m_binWidth.push_back(it->fh - it->fl);
+    }
+
+    /* a bin belongs to a subband when its center frequency lies inside it */
+    for(std::vector<Subband>::iterator sb = m_subbands.begin(); sb != m_subbands.end(); ++sb)
+    {
+        sb->firstBin = model->GetNumBands();
+        sb->lastBin = 0;
+        uint32_t i = 0;
+        for(Bands::const_iterator it = model->Begin(); it != model->End(); ++it, ++i)
+        {
+            if(it->fc >= sb->fLow && it->fc <= sb->fHigh)
+            {
+                sb->firstBin = std::min(sb->firstBin, i);
+                sb->lastBin = i + 1;
+            }
+        }
+        if(sb->lastBin == 0)
+        {
+            NS_LOG_WARN("Subband " << sb->name << " does not overlap the analyzer spectrum model");
+            sb->firstBin = 0;
+        }
+    }
+    m_modelUid = model->GetUid();
+}
+
+void
+SpectrumOccupancySink::ReportPsd(Ptr<const SpectrumValue> psd)
+{
+    Ptr<const SpectrumModel> model = psd->GetSpectrumModel();
+    if(model->GetUid() != m_modelUid)
+    {
+        ResolveBins(model);
+    }
+
+    if(m_samples == 0)
+    {
+        m_firstSample = Simulator::Now();
+    }
+    m_lastSample = Simulator::Now();
+    m_samples++;
+
+    uint32_t n = m_subbands.size();
+    uint32_t nBusy = 0;
+    for(uint32_t k = 0; k < n; k++)
+    {
+        Subband &sb = m_subbands[k];
+        /* integrate the PSD (W/Hz) over the subband bins */
+        double powerW = 0;
+        for(uint32_t i = sb.firstBin; i < sb.lastBin; i++)
+        {
+            powerW += (*psd)[i] * m_binWidth[i];
+        }
+
+        sb.maxPowerW = std::max(sb.maxPowerW, powerW);
+        double powerDbm = (powerW > 0) ? 10.0 * std::log10(powerW) + 30.0 : -1000.0;
+        int32_t bin = static_cast<int32_t>(std::floor((powerDbm + 110.0) / 5.0));
+        bin = std::max(0, std::min(bin, static_cast<int32_t>(POWER_HISTOGRAM_BINS) - 1));
+        sb.powerHistogram[bin]++;
+
+        m_isBusy[k] = (powerW > m_thresholdW) ? 1 : 0;
+        if(m_isBusy[k])
+        {
+            sb.busy++;
+            nBusy++;
+        }
+    }
+
+    m_nBusy[nBusy]++;
+    if(nBusy > 1)
+    {
+        for(uint32_t i = 0; i < n; i++)
+        {
+            if(!m_isBusy[i])
+            {
+                continue;
+            }
+            for(uint32_t j = i + 1; j < n; j++)
+            {
+                if(m_isBusy[j])
+                {
+                    m_pairBusy[i * n + j]++;
+                }
+            }
+        }
+    }
+}
+
+uint64_t
+SpectrumOccupancySink::GetSampleCount()
+{
+    return m_samples;
+}
+
+double
+SpectrumOccupancySink::GetDutyCycle(uint32_t subband)
+{
+    NS_ASSERT (subband < m_subbands.size());
+    if(m_samples == 0)
+    {
+        return 0;
+    }
+    return m_subbands[subband].busy / static_cast<double>(m_samples);
+}
+
+double
+SpectrumOccupancySink::GetOverlap(uint32_t subband1, uint32_t subband2)
+{
+    uint32_t n = m_subbands.size();
+    NS_ASSERT (subband1 < n && subband2 < n);
+    if(m_samples == 0)
+    {
+        return 0;
+    }
+    if(subband1 == subband2)
+    {
+        return GetDutyCycle(subband1);
+    }
+    uint32_t i = std::min(subband1, subband2);
+    uint32_t j = std::max(subband1, subband2);
+    return m_pairBusy[i * n + j] / static_cast<double>(m_samples);
+}
+
+void
+SpectrumOccupancySink::PrintSummary(std::ostream &os)
+{
+    uint32_t n = m_subbands.size();
+    os << "# spectrum occupancy summary" << std::endl;
+    os << "# samples " << m_samples
+       << " from " << m_firstSample.GetSeconds() << "s to " << m_lastSample.GetSeconds() << "s"
+       << ", threshold " << m_thresholdDbm << " dBm" << std::endl;
+
+    os << "# subband\tfLow(MHz)\tfHigh(MHz)\tbins\tbusy\tdutyCycle\tmaxPower(dBm)" << std::endl;
+    for(uint32_t k = 0; k < n; k++)
+    {
+        const Subband &sb = m_subbands[k];
+        double maxDbm = (sb.maxPowerW > 0) ? 10.0 * std::log10(sb.maxPowerW) + 30.0 : -1000.0;
+        os << sb.name << "\t" << sb.fLow / 1e6 << "\t" << sb.fHigh / 1e6 << "\t"
+           << sb.lastBin - sb.firstBin << "\t" << sb.busy << "\t" << GetDutyCycle(k) << "\t"
+           << maxDbm << std::endl;
+    }
+
+    os << "# overlap (fraction of samples both busy)" << std::endl;
+    for(uint32_t i = 0; i < n; i++)
+    {
+        for(uint32_t j = i + 1; j < n; j++)
+        {
+            os << m_subbands[i].name << "\t" << m_subbands[j].name << "\t"
+               << m_pairBusy[i * n + j] << "\t" << GetOverlap(i, j) << std::endl;
+        }
+    }
+
+    os << "# busy subbands per sample histogram" << std::endl;
+    for(uint32_t k = 0; k <= n; k++)
+    {
+        os << k << "\t" << m_nBusy[k] << std::endl;
+    }
+
+    os << "# integrated power histogram (dBm lower edge, counts per subband)" << std::endl;
+    for(uint32_t b = 0; b < POWER_HISTOGRAM_BINS; b++)
+    {
+        os << -110 + 5 * static_cast<int32_t>(b);
+        for(uint32_t k = 0; k < n; k++)
+        {
+            os << "\t" << m_subbands[k].powerHistogram[b];
+        }
+        os << std::endl;
+    }
+}
+
+void
+SpectrumOccupancySink::WriteSummary(std::string filename)
+{
+    std::ofstream file(filename.c_str());
+    NS_ABORT_MSG_IF (!file.is_open(), "Cannot open " << filename);
+    PrintSummary(file);
+}
+
+}   /* ns3 */
+
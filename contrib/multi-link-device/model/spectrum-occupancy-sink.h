@@ -0,0 +1,90 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef SPECTRUM_OCCUPANCY_SINK_H
+#define SPECTRUM_OCCUPANCY_SINK_H
+
+#include "ns3/object.h"
+#include "ns3/net-device.h"
+#include "ns3/nstime.h"
+#include "ns3/spectrum-value.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Reduce the average PSD reports of a SpectrumAnalyzer into per-subband
+ * occupancy counters as they arrive, instead of dumping every sample.
+ * A subband is "busy" in a sample when its integrated power is above the
+ * energy threshold. Memory use only depends on the number of subbands.
+ */
+class SpectrumOccupancySink : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    SpectrumOccupancySink();
+    virtual ~SpectrumOccupancySink();
+
+    /* track subband [fLow, fHigh] (Hz), return its index */
+    uint32_t AddSubband(std::string name, double fLow, double fHigh);
+    /* get number of tracked subbands */
+    uint32_t GetNSubbands();
+    /* energy threshold (dBm) setting */
+    void SetThreshold(double thresholdDbm);
+    /* get energy threshold (dBm) */
+    double GetThreshold();
+    /* connect this sink to the PSD report of a spectrum analyzer device */
+    void ConnectToAnalyzer(Ptr<NetDevice> analyzerDevice);
+    /* reduce one average PSD sample into the counters */
+    void ReportPsd(Ptr<const SpectrumValue> psd);
+
+    /* get number of samples reduced so far */
+    uint64_t GetSampleCount();
+    /* fraction of samples where the subband was busy */
+    double GetDutyCycle(uint32_t subband);
+    /* fraction of samples where both subbands were busy */
+    double GetOverlap(uint32_t subband1, uint32_t subband2);
+    /* print the occupancy summary */
+    void PrintSummary(std::ostream &os);
+    /* write the occupancy summary to a file */
+    void WriteSummary(std::string filename);
+
+    static const uint32_t POWER_HISTOGRAM_BINS = 20;   // 5 dB bins from -110 dBm to -10 dBm
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    /* map subband edges onto the bins of the analyzer spectrum model */
+    void ResolveBins(Ptr<const SpectrumModel> model);
+
+    struct Subband
+    {
+        std::string name;       // subband label used in the summary
+        double      fLow;       // lower edge (Hz)
+        double      fHigh;      // upper edge (Hz)
+        uint32_t    firstBin;   // first analyzer bin inside the subband
+        uint32_t    lastBin;    // one past the last analyzer bin inside the subband
+        uint64_t    busy;       // number of samples above threshold
+        double      maxPowerW;  // highest integrated power seen (W)
+        uint64_t    powerHistogram[POWER_HISTOGRAM_BINS];  // integrated power distribution
+    };
+
+    double      m_thresholdDbm;     // energy detection threshold (dBm)
+    double      m_thresholdW;       // energy detection threshold (W)
+    uint64_t    m_samples;          // number of PSD samples reduced
+    Time        m_firstSample;      // time of the first sample
+    Time        m_lastSample;       // time of the last sample
+    SpectrumModelUid_t m_modelUid;  // spectrum model the bin ranges were resolved for
+    std::vector<Subband>  m_subbands;      // tracked subbands
+    std::vector<double>   m_binWidth;      // width (Hz) of every analyzer bin
+    std::vector<uint64_t> m_nBusy;         // samples with exactly k subbands busy
+    std::vector<uint64_t> m_pairBusy;      // samples with subbands i and j both busy (N x N)
+    std::vector<uint8_t>  m_isBusy;        // scratch: busy flag of every subband in the current sample
+};
+
+}   /* ns3 */
+
+#endif /* SPECTRUM_OCCUPANCY_SINK_H */
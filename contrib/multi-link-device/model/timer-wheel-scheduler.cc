@@ -0,0 +1,259 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/timer-wheel-scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("TimerWheelScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (TimerWheelScheduler);
+
+/* uid order of the events of a finest wheel slot, which share their timestamp */
+static bool
+UidLess(const Scheduler::Event &a, const Scheduler::Event &b)
+{
+    return a.key.m_uid < b.key.m_uid;
+}
+
+TypeId
+TimerWheelScheduler::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::TimerWheelScheduler")
+        .SetParent<Scheduler> ()
+        .AddConstructor<TimerWheelScheduler> ();
+
+        return tid;
+}
+
+TimerWheelScheduler::TimerWheelScheduler()
+    : m_cursor (0),
+      m_size (0)
+{
+    std::memset(m_occupied, 0, sizeof(m_occupied));
+    std::memset(m_wheelSize, 0, sizeof(m_wheelSize));
+    std::memset(m_head, 0, sizeof(m_head));
+}
+
+TimerWheelScheduler::~TimerWheelScheduler()
+{}
+
+bool
+TimerWheelScheduler::Locate(uint64_t ts, uint32_t &level, uint32_t &slot) const
+{
+    NS_ASSERT (ts >= m_cursor);
+    uint64_t diff = ts ^ m_cursor;
+    if((diff >> (LEVELS * SLOT_BITS)) != 0)
+    {
+        return false;
+    }
+    /* wheel of the highest group of bits that differs from the cursor */
+    level = 0;
+    while(level + 1 < LEVELS && (diff >> ((level + 1) * SLOT_BITS)) != 0)
+    {
+        level++;
+    }
+    slot = (ts >> (level * SLOT_BITS)) & (SLOTS - 1);
+    return true;
+}
+
+void
+TimerWheelScheduler::Place(const Event &ev)
+{
+    uint32_t level, slot;
+    if(!Locate(ev.key.m_ts, level, slot))
+    {
+        m_overflow.insert(std::make_pair(ev.key, ev.impl));
+        return;
+    }
+    std::vector<Event> &events = m_slots[level][slot];
+    if(level == 0)
+    {
+        /* new events have the highest uid, cascaded ones are inserted in order */
+        events.insert(std::upper_bound(events.begin() + m_head[slot], events.end(), ev, UidLess), ev);
+    }
+    else
+    {
+        events.push_back(ev);
+    }
+    m_occupied[level][slot / 64] |= (uint64_t)1 << (slot % 64);
+    m_wheelSize[level]++;
+}
+
+uint32_t
+TimerWheelScheduler::FindSlot(uint32_t level, uint32_t from) const
+{
+    for(uint32_t word = from / 64; word < SLOTS / 64; word++)
+    {
+        uint64_t bits = m_occupied[level][word];
+        if(word == from / 64)
+        {
+            bits &= ~(uint64_t)0 << (from % 64);
+        }
+        if(bits != 0)
+        {
+            return word * 64 + __builtin_ctzll(bits);
+        }
+    }
+    return SLOTS;
+}
+
+void
+TimerWheelScheduler::Cascade(uint32_t level, uint32_t slot)
+{
+    std::vector<Event> events;
+    events.swap(m_slots[level][slot]);
+    ReleaseSlot(level, slot);
+    m_wheelSize[level] -= events.size();
+
+    /* every event of the slot is at or after its start, every other one after */
+    uint64_t mask = ((uint64_t)1 << ((level + 1) * SLOT_BITS)) - 1;
+    m_cursor = (m_cursor & ~mask) | ((uint64_t)slot << (level * SLOT_BITS));
+    for(std::vector<Event>::iterator it = events.begin(); it != events.end(); ++it)
+    {
+        Place(*it);
+    }
+}
+
+void
+TimerWheelScheduler::Refill()
+{
+    NS_ASSERT (!m_overflow.empty());
+    m_cursor = m_overflow.begin()->first.m_ts;
+    std::map<EventKey, EventImpl *>::iterator it = m_overflow.begin();
+    while(it != m_overflow.end() && ((it->first.m_ts ^ m_cursor) >> (LEVELS * SLOT_BITS)) == 0)
+    {
+        Event ev;
+        ev.impl = it->second;
+        ev.key = it->first;
+        m_overflow.erase(it++);
+        Place(ev);
+    }
+    NS_LOG_LOGIC("[Refill] cursor " << m_cursor << ", " << m_overflow.size() << " events left beyond the wheels");
+}
+
+void
+TimerWheelScheduler::ReleaseSlot(uint32_t level, uint32_t slot)
+{
+    m_slots[level][slot].clear();
+    m_occupied[level][slot / 64] &= ~((uint64_t)1 << (slot % 64));
+    if(level == 0)
+    {
+        m_head[slot] = 0;
+    }
+}
+
+void
+TimerWheelScheduler::Insert (const Event &ev)
+{
+    Place(ev);
+    m_size++;
+}
+
+bool
+TimerWheelScheduler::IsEmpty (void) const
+{
+    return m_size == 0;
+}
+
+Scheduler::Event
+TimerWheelScheduler::PeekNext (void) const
+{
+    NS_ASSERT (!IsEmpty());
+    uint32_t slot = FindSlot(0, m_cursor & (SLOTS - 1));
+    if(slot < SLOTS)
+    {
+        return m_slots[0][slot][m_head[slot]];
+    }
+    /* the earliest event is in the first slot of the finest non-empty wheel, which is not sorted */
+    for(uint32_t level = 1; level < LEVELS; level++)
+    {
+        if(m_wheelSize[level] == 0)
+        {
+            continue;
+        }
+        slot = FindSlot(level, (m_cursor >> (level * SLOT_BITS)) & (SLOTS - 1));
+        NS_ASSERT (slot < SLOTS);
+        const std::vector<Event> &events = m_slots[level][slot];
+        return *std::min_element(events.begin(), events.end());
+    }
+    Event ev;
+    ev.impl = m_overflow.begin()->second;
+    ev.key = m_overflow.begin()->first;
+    return ev;
+}
+
+Scheduler::Event
+TimerWheelScheduler::RemoveNext (void)
+{
+    NS_ASSERT (!IsEmpty());
+    while(true)
+    {
+        uint32_t slot = FindSlot(0, m_cursor & (SLOTS - 1));
+        if(slot < SLOTS)
+        {
+            std::vector<Event> &events = m_slots[0][slot];
+            Event ev = events[m_head[slot]++];
+            if(m_head[slot] == events.size())
+            {
+                ReleaseSlot(0, slot);
+            }
+            m_wheelSize[0]--;
+            m_size--;
+            m_cursor = ev.key.m_ts;
+            return ev;
+        }
+        /* the finest wheel is done: bring the next slot of a coarser wheel, or the overflow, down */
+        uint32_t level = 1;
+        while(level < LEVELS && m_wheelSize[level] == 0)
+        {
+            level++;
+        }
+        if(level < LEVELS)
+        {
+            slot = FindSlot(level, (m_cursor >> (level * SLOT_BITS)) & (SLOTS - 1));
+            NS_ASSERT (slot < SLOTS);
+            Cascade(level, slot);
+        }
+        else
+        {
+            Refill();
+        }
+    }
+}
+
+void
+TimerWheelScheduler::Remove (const Event &ev)
+{
+    uint32_t level, slot;
+    if(!Locate(ev.key.m_ts, level, slot))
+    {
+        std::map<EventKey, EventImpl *>::iterator it = m_overflow.find(ev.key);
+        NS_ABORT_MSG_IF (it == m_overflow.end() || it->second != ev.impl, "Removing an event that is not scheduled");
+        m_overflow.erase(it);
+        m_size--;
+        return;
+    }
+    std::vector<Event> &events = m_slots[level][slot];
+    std::vector<Event>::iterator it = events.begin() + ((level == 0)? m_head[slot] : 0);
+    while(it != events.end() && it->key.m_uid != ev.key.m_uid)
+    {
+        ++it;
+    }
+    NS_ABORT_MSG_IF (it == events.end() || it->impl != ev.impl, "Removing an event that is not scheduled");
+    events.erase(it);
+    if((level > 0)? events.empty() : m_head[slot] == events.size())
+    {
+        ReleaseSlot(level, slot);
+    }
+    m_wheelSize[level]--;
+    m_size--;
+}
+
+}   /* ns3 */
@@ -0,0 +1,70 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef TIMER_WHEEL_SCHEDULER_H
+#define TIMER_WHEEL_SCHEDULER_H
+
+#include "ns3/scheduler.h"
+
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Hierarchical timer-wheel event scheduler, selected with
+ * GlobalValue SchedulerType = "ns3::TimerWheelScheduler".
+ *
+ * Four wheels of 256 slots cover 2^32 time steps (about 4.3 s at the default
+ * nanosecond resolution) ahead of the cursor, the timestamp of the last
+ * removed event. An event goes to the wheel of the highest 8-bit group in
+ * which its timestamp differs from the cursor: inserting is O(1), and so is
+ * removing from a finer wheel; a coarse slot is cascaded to the finer wheels
+ * when the cursor reaches it. Events further ahead wait in an ordered map.
+ * Slots of the finest wheel hold events of a single timestamp sorted by uid,
+ * so events come out in the exact (timestamp, uid) order of MapScheduler;
+ * they are consumed from a head index, so a batch of events sharing a
+ * timestamp is drained in linear time.
+ */
+class TimerWheelScheduler : public Scheduler
+{
+public:
+    static TypeId GetTypeId (void);
+
+    TimerWheelScheduler();
+    virtual ~TimerWheelScheduler();
+
+    virtual void Insert (const Event &ev);
+    virtual bool IsEmpty (void) const;
+    virtual Event PeekNext (void) const;
+    virtual Event RemoveNext (void);
+    virtual void Remove (const Event &ev);
+
+    static const uint32_t LEVELS = 4;   // wheels
+    static const uint32_t SLOT_BITS = 8;     // timestamp bits per wheel
+    static const uint32_t SLOTS = 1 << SLOT_BITS;    // slots per wheel
+
+private:
+    /* wheel and slot of a timestamp relative to the cursor, false if beyond the wheels */
+    bool Locate(uint64_t ts, uint32_t &level, uint32_t &slot) const;
+    /* store an event in the wheels or the overflow map */
+    void Place(const Event &ev);
+    /* first non-empty slot of a wheel from a slot on, SLOTS if none */
+    uint32_t FindSlot(uint32_t level, uint32_t from) const;
+    /* move the events of a coarse slot to the finer wheels, the cursor going to the start of the slot */
+    void Cascade(uint32_t level, uint32_t slot);
+    /* move the events of the overflow map now within the wheels, the cursor going to the earliest one */
+    void Refill();
+    /* empty a slot of a wheel once its last event is out */
+    void ReleaseSlot(uint32_t level, uint32_t slot);
+
+    std::vector<Event> m_slots[LEVELS][SLOTS];   // events of every slot, finest wheel sorted by uid
+    uint32_t    m_head[SLOTS];                    // first event not removed yet of every finest wheel slot
+    uint64_t    m_occupied[LEVELS][SLOTS / 64];  // bitmap of the non-empty slots
+    uint32_t    m_wheelSize[LEVELS];              // events in every wheel
+    std::map<EventKey, EventImpl *> m_overflow;  // events beyond the wheels
+    uint64_t    m_cursor;                         // timestamp of the last removed event
+    uint32_t    m_size;                           // events scheduled
+};
+
+}   /* ns3 */
+
+#endif /* TIMER_WHEEL_SCHEDULER_H */
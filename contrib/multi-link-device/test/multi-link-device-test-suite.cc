@@ -2,9 +2,43 @@
 
 // Include a header file from your module to test.
 #include "ns3/multi-link-device.h"
+#include "ns3/multi-link-device-helper.h"
+#include "ns3/mld-sequence-tag.h"
+#include "ns3/mld-pcap-writer.h"
+#include "ns3/timer-wheel-scheduler.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/uinteger.h"
+#include "ns3/spectrum-occupancy-sink.h"
+#include "ns3/lookup-error-rate-model.h"
+#include "ns3/nist-error-rate-model.h"
+#include "ns3/yans-error-rate-model.h"
+#include "ns3/wifi-tx-vector.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/cached-propagation-model.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/error-model.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/arp-cache.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
+#include "ns3/boolean.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <sstream>
+#include <vector>
 
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
@@ -46,6 +80,1091 @@ MultiLinkDeviceTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+// Feed synthetic PSD samples to the occupancy sink and check its counters
+class SpectrumOccupancySinkTestCase : public TestCase
+{
+public:
+  SpectrumOccupancySinkTestCase ();
+  virtual ~SpectrumOccupancySinkTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SpectrumOccupancySinkTestCase::SpectrumOccupancySinkTestCase ()
+  : TestCase ("Spectrum occupancy sink duty cycle and overlap")
+{
+}
+
+SpectrumOccupancySinkTestCase::~SpectrumOccupancySinkTestCase ()
+{
+}
+
+void
+SpectrumOccupancySinkTestCase::DoRun (void)
+{
+  // four 10 MHz bins from 5000 MHz to 5040 MHz
+  std::vector<double> centerFrequencies;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      centerFrequencies.push_back (5005e6 + i * 10e6);
+    }
+  Ptr<SpectrumModel> model = Create<SpectrumModel> (centerFrequencies);
+
+  Ptr<SpectrumOccupancySink> sink = CreateObject<SpectrumOccupancySink> ();
+  sink->SetThreshold (-62.0);
+  uint32_t a = sink->AddSubband ("A", 5000e6, 5020e6);
+  uint32_t b = sink->AddSubband ("B", 5020e6, 5040e6);
+
+  // -50 dBm over a single 10 MHz bin
+  double busyPsd = 1e-8 / 10e6;
+
+  Ptr<SpectrumValue> onlyA = Create<SpectrumValue> (model);
+  (*onlyA)[0] = busyPsd;
+  Ptr<SpectrumValue> both = Create<SpectrumValue> (model);
+  (*both)[1] = busyPsd;
+  (*both)[3] = busyPsd;
+  Ptr<SpectrumValue> idle = Create<SpectrumValue> (model);
+
+  sink->ReportPsd (onlyA);
+  sink->ReportPsd (both);
+  sink->ReportPsd (idle);
+
+  NS_TEST_ASSERT_MSG_EQ (sink->GetSampleCount (), 3, "Wrong number of reduced samples");
+  NS_TEST_ASSERT_MSG_EQ_TOL (sink->GetDutyCycle (a), 2.0 / 3, 1e-9, "Wrong duty cycle for subband A");
+  NS_TEST_ASSERT_MSG_EQ_TOL (sink->GetDutyCycle (b), 1.0 / 3, 1e-9, "Wrong duty cycle for subband B");
+  NS_TEST_ASSERT_MSG_EQ_TOL (sink->GetOverlap (a, b), 1.0 / 3, 1e-9, "Wrong overlap between A and B");
+
+  Simulator::Destroy ();
+}
+
+// Compare table lookups against NistErrorRateModel over HE MCSs, SNRs and chunk lengths
+class LookupErrorRateModelTestCase : public TestCase
+{
+public:
+  LookupErrorRateModelTestCase ();
+  virtual ~LookupErrorRateModelTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LookupErrorRateModelTestCase::LookupErrorRateModelTestCase ()
+  : TestCase ("Lookup error rate model matches NistErrorRateModel")
+{
+}
+
+LookupErrorRateModelTestCase::~LookupErrorRateModelTestCase ()
+{
+}
+
+void
+LookupErrorRateModelTestCase::DoRun (void)
+{
+  Ptr<LookupErrorRateModel> lookup = CreateObject<LookupErrorRateModel> ();
+  lookup->SetAttribute ("AccuracyCheck", BooleanValue (true));
+  Ptr<NistErrorRateModel> nist = CreateObject<NistErrorRateModel> ();
+
+  uint64_t chunkLengths[] = {100, 1000, 8192, 12000, 65535};
+  for (uint8_t mcs = 0; mcs < 12; mcs++)
+    {
+      std::ostringstream name;
+      name << "HeMcs" << +mcs;
+      WifiMode mode (name.str ());
+      WifiTxVector txVector;
+      txVector.SetMode (mode);
+      txVector.SetChannelWidth (20);
+      for (double snrDb = -5.0; snrDb <= 40.0; snrDb += 0.37)
+        {
+          double snr = std::pow (10.0, snrDb / 10.0);
+          for (uint32_t i = 0; i < sizeof (chunkLengths) / sizeof (chunkLengths[0]); i++)
+            {
+              double expected = nist->GetChunkSuccessRate (mode, txVector, snr, chunkLengths[i]);
+              double actual = lookup->GetChunkSuccessRate (mode, txVector, snr, chunkLengths[i]);
+              NS_TEST_ASSERT_MSG_EQ_TOL (actual, expected, 0.01, "Lookup differs from NIST for " << mode
+                                         << " at " << snrDb << " dB, " << chunkLengths[i] << " bits");
+            }
+        }
+    }
+  NS_TEST_ASSERT_MSG_GT (lookup->GetNChecks (), 0, "Accuracy check mode did not compare any lookup");
+  NS_TEST_ASSERT_MSG_LT (lookup->GetMaxAbsError (), 0.01, "Accuracy check reports a too large error");
+
+  // Tables cached for one reference model must not be served for another one
+  std::string cacheFile = CreateTempDirFilename ("error-rate-tables.txt");
+  WifiMode mode ("HeMcs4");
+  WifiTxVector txVector;
+  txVector.SetMode (mode);
+  txVector.SetChannelWidth (20);
+  double snr = std::pow (10.0, 14.0 / 10.0);
+  Ptr<LookupErrorRateModel> cached = CreateObject<LookupErrorRateModel> ();
+  cached->SetAttribute ("CacheFile", StringValue (cacheFile));
+  cached->GetChunkSuccessRate (mode, txVector, snr, 1000);
+  cached->SaveCache ();
+
+  Ptr<YansErrorRateModel> yans = CreateObject<YansErrorRateModel> ();
+  Ptr<LookupErrorRateModel> reloaded = CreateObject<LookupErrorRateModel> ();
+  reloaded->SetAttribute ("CacheFile", StringValue (cacheFile));
+  reloaded->SetReferenceModel (yans);
+  NS_TEST_ASSERT_MSG_EQ_TOL (reloaded->GetChunkSuccessRate (mode, txVector, snr, 1000),
+                             yans->GetChunkSuccessRate (mode, txVector, snr, 1000), 0.01,
+                             "Lookup served a table cached for another reference model");
+  cached->Dispose ();
+  reloaded->Dispose ();
+}
+
+// Check the propagation cache against the wrapped model, including after a course change
+class CachedPropagationModelTestCase : public TestCase
+{
+public:
+  CachedPropagationModelTestCase ();
+  virtual ~CachedPropagationModelTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+CachedPropagationModelTestCase::CachedPropagationModelTestCase ()
+  : TestCase ("Cached propagation loss/delay hits, misses and invalidation")
+{
+}
+
+CachedPropagationModelTestCase::~CachedPropagationModelTestCase ()
+{
+}
+
+void
+CachedPropagationModelTestCase::DoRun (void)
+{
+  Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0, 0, 0));
+  Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  b->SetPosition (Vector (10, 0, 0));
+
+  Ptr<FriisPropagationLossModel> friis = CreateObject<FriisPropagationLossModel> ();
+  Ptr<CachedPropagationLossModel> loss = CreateObject<CachedPropagationLossModel> ();
+  loss->SetModel (friis);
+  Ptr<ConstantSpeedPropagationDelayModel> speed = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  Ptr<CachedPropagationDelayModel> delay = CreateObject<CachedPropagationDelayModel> ();
+  delay->SetModel (speed);
+
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (loss->CalcRxPower (20.0, a, b), friis->CalcRxPower (20.0, a, b), 1e-9,
+                                 "Cached loss differs from the wrapped model");
+      NS_TEST_ASSERT_MSG_EQ (delay->GetDelay (a, b), speed->GetDelay (a, b), "Cached delay differs from the wrapped model");
+    }
+  NS_TEST_ASSERT_MSG_EQ (loss->GetMisses (), 1, "Only the first loss should be computed");
+  NS_TEST_ASSERT_MSG_EQ (loss->GetHits (), 2, "Following losses should be served from the cache");
+  NS_TEST_ASSERT_MSG_EQ (delay->GetMisses (), 1, "Only the first delay should be computed");
+
+  // moving a node drops its entries
+  b->SetPosition (Vector (100, 0, 0));
+  NS_TEST_ASSERT_MSG_EQ (loss->GetInvalidations (), 1, "Course change should invalidate the loss entries");
+  NS_TEST_ASSERT_MSG_EQ_TOL (loss->CalcRxPower (20.0, a, b), friis->CalcRxPower (20.0, a, b), 1e-9,
+                             "Cached loss not recomputed after a course change");
+  NS_TEST_ASSERT_MSG_EQ (delay->GetDelay (a, b), speed->GetDelay (a, b), "Cached delay not recomputed after a course change");
+  NS_TEST_ASSERT_MSG_EQ (loss->GetMisses (), 2, "Loss should be computed again after a course change");
+
+  // course changes that find nothing cached are not counted
+  b->SetPosition (Vector (200, 0, 0));
+  b->SetPosition (Vector (300, 0, 0));
+  NS_TEST_ASSERT_MSG_EQ (loss->GetInvalidations (), 2, "Only course changes dropping entries should be counted");
+  NS_TEST_ASSERT_MSG_EQ_TOL (loss->CalcRxPower (20.0, b, a), friis->CalcRxPower (20.0, b, a), 1e-9,
+                             "Cached loss differs from the wrapped model in the reverse direction");
+  a->SetPosition (Vector (0, 10, 0));
+  NS_TEST_ASSERT_MSG_EQ (loss->GetInvalidations (), 3, "Course change of the receiver should drop the pair");
+  NS_TEST_ASSERT_MSG_EQ_TOL (loss->CalcRxPower (20.0, b, a), friis->CalcRxPower (20.0, b, a), 1e-9,
+                             "Cached loss not recomputed after a course change of the receiver");
+  NS_TEST_ASSERT_MSG_EQ (loss->GetMisses (), 4, "Loss should be computed again after a receiver course change");
+
+  loss->Dispose ();
+  delay->Dispose ();
+  Simulator::Destroy ();
+}
+
+// Feed tagged packets to an MLD and check that duplicates are dropped
+class MldSequenceDuplicateTestCase : public TestCase
+{
+public:
+  MldSequenceDuplicateTestCase ();
+  virtual ~MldSequenceDuplicateTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<MultiLinkDevice> mld, uint32_t sequence, uint32_t source = 0);
+};
+
+MldSequenceDuplicateTestCase::MldSequenceDuplicateTestCase ()
+  : TestCase ("MLD sequence numbers drop duplicates received on either link, per sender")
+{
+}
+
+MldSequenceDuplicateTestCase::~MldSequenceDuplicateTestCase ()
+{
+}
+
+void
+MldSequenceDuplicateTestCase::Receive (Ptr<MultiLinkDevice> mld, uint32_t sequence, uint32_t source)
+{
+  Ptr<Packet> packet = Create<Packet> (100);
+  MldSequenceTag tag (sequence, Seconds (0));
+  tag.SetSource (source);
+  packet->AddPacketTag (tag);
+  mld->ReceivePacket (0, packet, MultiLinkDevice::PROT_NUMBER, Address (), Address (), NetDevice::PACKET_HOST);
+}
+
+void
+MldSequenceDuplicateTestCase::DoRun (void)
+{
+  Ptr<MultiLinkDevice> mld = CreateObject<MultiLinkDevice> ();
+  Receive (mld, 0);
+  Receive (mld, 2);
+  Receive (mld, 1);   // late, but not seen yet
+  Receive (mld, 2);   // retransmitted on the other link
+  NS_TEST_ASSERT_MSG_EQ (mld->GetTotalReceive (), 3, "Out of order packets should be counted once");
+  NS_TEST_ASSERT_MSG_EQ (mld->GetDuplicates (), 1, "Second copy of a packet should be a duplicate");
+
+  // a jump past the window forgets everything older
+  Receive (mld, 2 + MultiLinkDevice::RX_WINDOW + 10);
+  Receive (mld, 5);
+  NS_TEST_ASSERT_MSG_EQ (mld->GetTooOld (), 1, "Packets older than the window should be dropped as too old");
+  NS_TEST_ASSERT_MSG_EQ (mld->GetDuplicates (), 1, "Packets older than the window are not known duplicates");
+  Receive (mld, 2 + MultiLinkDevice::RX_WINDOW);
+  NS_TEST_ASSERT_MSG_EQ (mld->GetTotalReceive (), 5, "Packets inside the window should be counted");
+
+  // every sender has its own sequence space
+  Receive (mld, 0, 1);
+  Receive (mld, 2, 1);
+  NS_TEST_ASSERT_MSG_EQ (mld->GetTotalReceive (), 7, "Sequence numbers of another sender should not be duplicates");
+  Receive (mld, 2, 1);
+  NS_TEST_ASSERT_MSG_EQ (mld->GetDuplicates (), 2, "Duplicates should be detected per sender");
+}
+
+// Write frames of two links through the asynchronous capture and parse the pcapng file back
+class MldPcapWriterTestCase : public TestCase
+{
+public:
+  MldPcapWriterTestCase ();
+  virtual ~MldPcapWriterTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MldPcapWriterTestCase::MldPcapWriterTestCase ()
+  : TestCase ("Asynchronous pcapng capture of several links with snaplen truncation and backpressure")
+{
+}
+
+MldPcapWriterTestCase::~MldPcapWriterTestCase ()
+{
+}
+
+void
+MldPcapWriterTestCase::DoRun (void)
+{
+  Ptr<MldPcapWriter> writer = CreateObject<MldPcapWriter> ();
+  writer->SetAttribute ("SnapLen", UintegerValue (64));
+  // a one record ring: every frame waits for the writer thread
+  writer->SetAttribute ("QueueSize", UintegerValue (1));
+  writer->SetAttribute ("Backpressure", BooleanValue (true));
+  writer->AddInterface ("link1");
+  writer->AddInterface ("link2");
+  writer->Open (CreateTempDirFilename ("mld-capture.pcapng"));
+  writer->Capture (0, Create<Packet> (40));
+  writer->Capture (1, Create<Packet> (100));
+  // the links of another MLD join the running capture
+  NS_TEST_ASSERT_MSG_EQ (writer->AddInterface ("link3"), 2, "Interfaces are numbered in order");
+  writer->Capture (2, Create<Packet> (64));
+  writer->Close ();
+  writer->Capture (0, Create<Packet> (40));
+  NS_TEST_ASSERT_MSG_EQ (writer->GetCaptured (), 3, "Every frame until Close should be queued");
+  NS_TEST_ASSERT_MSG_EQ (writer->GetDropped (), 0, "No frame should be dropped with backpressure");
+
+  std::ifstream file (writer->GetFilename ().c_str (), std::ios::binary);
+  std::vector<char> bytes ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+  uint32_t blocks[3] = {0, 0, 0};   // SHB, IDB, EPB
+  std::vector<uint32_t> interfaces, captured, lengths;
+  std::vector<uint32_t> knownInterfaces;  // IDBs seen before each EPB
+  for (size_t offset = 0; offset + 12 <= bytes.size (); )
+    {
+      uint32_t type, length;
+      std::memcpy (&type, &bytes[offset], 4);
+      std::memcpy (&length, &bytes[offset + 4], 4);
+      NS_TEST_ASSERT_MSG_EQ (length % 4, 0, "Blocks should be padded to 32 bits");
+      if (type == 0x0A0D0D0A)
+        {
+          blocks[0]++;
+        }
+      else if (type == 1)
+        {
+          blocks[1]++;
+        }
+      else if (type == 6)
+        {
+          uint32_t value;
+          blocks[2]++;
+          std::memcpy (&value, &bytes[offset + 8], 4);
+          interfaces.push_back (value);
+          std::memcpy (&value, &bytes[offset + 20], 4);
+          captured.push_back (value);
+          std::memcpy (&value, &bytes[offset + 24], 4);
+          lengths.push_back (value);
+          knownInterfaces.push_back (blocks[1]);
+        }
+      offset += length;
+    }
+  NS_TEST_ASSERT_MSG_EQ (blocks[0], 1, "One section header expected");
+  NS_TEST_ASSERT_MSG_EQ (blocks[1], 3, "One interface per link expected");
+  NS_TEST_ASSERT_MSG_EQ (blocks[2], 3, "One packet block per frame expected");
+  NS_TEST_ASSERT_MSG_EQ (interfaces[1], 1, "Second frame belongs to the second link");
+  NS_TEST_ASSERT_MSG_EQ (interfaces[2], 2, "Third frame belongs to the added link");
+  NS_TEST_ASSERT_MSG_EQ (knownInterfaces[2], 3, "Interface should be written before its frames");
+  NS_TEST_ASSERT_MSG_EQ (captured[0], 40, "Short frames are kept whole");
+  NS_TEST_ASSERT_MSG_EQ (captured[1], 64, "Long frames are truncated to the snaplen");
+  NS_TEST_ASSERT_MSG_EQ (captured[2], 64, "Frames of the snaplen are kept whole");
+  NS_TEST_ASSERT_MSG_EQ (lengths[1], 100, "Original length is kept");
+}
+
+// Drive the timer wheel and MapScheduler with the same random events and compare the order
+class TimerWheelSchedulerTestCase : public TestCase
+{
+public:
+  TimerWheelSchedulerTestCase ();
+  virtual ~TimerWheelSchedulerTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+TimerWheelSchedulerTestCase::TimerWheelSchedulerTestCase ()
+  : TestCase ("Timer wheel scheduler keeps the (timestamp, uid) order of MapScheduler")
+{
+}
+
+TimerWheelSchedulerTestCase::~TimerWheelSchedulerTestCase ()
+{
+}
+
+void
+TimerWheelSchedulerTestCase::DoRun (void)
+{
+  Ptr<TimerWheelScheduler> wheel = CreateObject<TimerWheelScheduler> ();
+  Ptr<MapScheduler> reference = CreateObject<MapScheduler> ();
+  std::mt19937_64 rng (1);
+  // delays hitting every wheel, the overflow map and ties
+  uint64_t spans[6] = {1, 300, 70000, 20000000, 1ULL << 33, 3};
+  std::vector<Scheduler::Event> pending;
+  std::vector<bool> removed;    // by uid, events already out of the schedulers
+  uint64_t now = 0;
+  uint32_t uid = 0;
+
+  for (uint32_t i = 0; i < 20000; i++)
+    {
+      uint32_t op = rng () % 10;
+      if (op < 5 || reference->IsEmpty ())
+        {
+          uint32_t span = rng () % 6;
+          Scheduler::Event ev;
+          ev.impl = 0;
+          ev.key.m_ts = now + ((span == 5) ? (rng () % 3) * 100000 : rng () % spans[span]);
+          ev.key.m_uid = uid++;
+          ev.key.m_context = 0;
+          wheel->Insert (ev);
+          reference->Insert (ev);
+          pending.push_back (ev);
+          removed.push_back (false);
+        }
+      else if (op < 8)
+        {
+          Scheduler::Event expected = reference->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (wheel->PeekNext ().key.m_uid, expected.key.m_uid, "Peeked event out of order");
+          NS_TEST_ASSERT_MSG_EQ (wheel->RemoveNext ().key.m_uid, expected.key.m_uid, "Removed event out of order");
+          removed[expected.key.m_uid] = true;
+          now = expected.key.m_ts;
+        }
+      else
+        {
+          // cancel an event, if it is still pending
+          uint32_t j = rng () % pending.size ();
+          Scheduler::Event ev = pending[j];
+          pending[j] = pending.back ();
+          pending.pop_back ();
+          if (!removed[ev.key.m_uid])
+            {
+              reference->Remove (ev);
+              wheel->Remove (ev);
+              removed[ev.key.m_uid] = true;
+            }
+        }
+    }
+  while (!reference->IsEmpty ())
+    {
+      NS_TEST_ASSERT_MSG_EQ (wheel->RemoveNext ().key.m_uid, reference->RemoveNext ().key.m_uid,
+                             "Remaining event out of order");
+    }
+  NS_TEST_ASSERT_MSG_EQ (wheel->IsEmpty (), true, "Timer wheel should be empty");
+}
+
+// Drain large batches of events sharing a timestamp, as many nodes starting at once schedule
+class TimerWheelBatchTestCase : public TestCase
+{
+public:
+  TimerWheelBatchTestCase ();
+  virtual ~TimerWheelBatchTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+TimerWheelBatchTestCase::TimerWheelBatchTestCase ()
+  : TestCase ("Timer wheel scheduler drains same-timestamp batches in MapScheduler order")
+{
+}
+
+TimerWheelBatchTestCase::~TimerWheelBatchTestCase ()
+{
+}
+
+void
+TimerWheelBatchTestCase::DoRun (void)
+{
+  Ptr<TimerWheelScheduler> wheel = CreateObject<TimerWheelScheduler> ();
+  Ptr<MapScheduler> reference = CreateObject<MapScheduler> ();
+  std::mt19937_64 rng (2);
+  std::vector<Scheduler::Event> pending;
+  std::vector<bool> removed;    // by uid, events already out of the schedulers
+  uint64_t now = 0;
+  uint32_t uid = 0;
+
+  for (uint32_t batch = 0; batch < 10; batch++)
+    {
+      // a batch at the current time or ahead, a few events one step later
+      uint64_t ts = now + ((batch % 3 == 0) ? 0 : rng () % (1 << 20));
+      for (uint32_t i = 0; i < 5000; i++)
+        {
+          Scheduler::Event ev;
+          ev.impl = 0;
+          ev.key.m_ts = (i % 7 == 0) ? ts + 1 : ts;
+          ev.key.m_uid = uid++;
+          ev.key.m_context = 0;
+          wheel->Insert (ev);
+          reference->Insert (ev);
+          pending.push_back (ev);
+          removed.push_back (false);
+        }
+      // drain most of it, scheduling now and cancelling in between
+      for (uint32_t i = 0; i < 6000 && !reference->IsEmpty (); i++)
+        {
+          uint32_t op = rng () % 10;
+          if (op < 7)
+            {
+              Scheduler::Event expected = reference->RemoveNext ();
+              NS_TEST_ASSERT_MSG_EQ (wheel->PeekNext ().key.m_uid, expected.key.m_uid, "Peeked event out of order");
+              NS_TEST_ASSERT_MSG_EQ (wheel->RemoveNext ().key.m_uid, expected.key.m_uid, "Removed event out of order");
+              removed[expected.key.m_uid] = true;
+              now = expected.key.m_ts;
+            }
+          else if (op < 8)
+            {
+              Scheduler::Event ev;
+              ev.impl = 0;
+              ev.key.m_ts = now;
+              ev.key.m_uid = uid++;
+              ev.key.m_context = 0;
+              wheel->Insert (ev);
+              reference->Insert (ev);
+              pending.push_back (ev);
+              removed.push_back (false);
+            }
+          else
+            {
+              uint32_t j = rng () % pending.size ();
+              Scheduler::Event ev = pending[j];
+              pending[j] = pending.back ();
+              pending.pop_back ();
+              if (!removed[ev.key.m_uid])
+                {
+                  reference->Remove (ev);
+                  wheel->Remove (ev);
+                  removed[ev.key.m_uid] = true;
+                }
+            }
+        }
+    }
+  while (!reference->IsEmpty ())
+    {
+      NS_TEST_ASSERT_MSG_EQ (wheel->RemoveNext ().key.m_uid, reference->RemoveNext ().key.m_uid,
+                             "Remaining event out of order");
+    }
+  NS_TEST_ASSERT_MSG_EQ (wheel->IsEmpty (), true, "Timer wheel should be empty");
+}
+
+// Lose every frame of link 1 at the AP MLD and check the STA MLD delivers everything on link 2
+class MldLinkLossTestCase : public TestCase
+{
+public:
+  MldLinkLossTestCase ();
+  virtual ~MldLinkLossTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Sent (Ptr<const Packet> packet);
+  void Received (Ptr<const Packet> packet, Time latency);
+
+  std::set<uint32_t> m_sent;        // sequence numbers generated before the last periods
+  std::set<uint32_t> m_received;    // sequence numbers delivered to the AP MLD
+};
+
+MldLinkLossTestCase::MldLinkLossTestCase ()
+  : TestCase ("Packets given up by the MAC of a lost link are delivered on the other link")
+{
+}
+
+MldLinkLossTestCase::~MldLinkLossTestCase ()
+{
+}
+
+void
+MldLinkLossTestCase::Sent (Ptr<const Packet> packet)
+{
+  MldSequenceTag tag;
+  // the last packets may still be on their way when the simulation ends
+  if (Simulator::Now () < Seconds (2.5) && packet->PeekPacketTag (tag))
+    {
+      m_sent.insert (tag.GetSequence ());
+    }
+}
+
+void
+MldLinkLossTestCase::Received (Ptr<const Packet> packet, Time latency)
+{
+  MldSequenceTag tag;
+  if (packet->PeekPacketTag (tag))
+    {
+      m_received.insert (tag.GetSequence ());
+    }
+}
+
+void
+MldLinkLossTestCase::DoRun (void)
+{
+  NodeContainer apNode;
+  apNode.Create (1);
+  NodeContainer staNodes;
+  staNodes.Create (1);
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211ax_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode", StringValue ("HeMcs7"),
+                                "ControlMode", StringValue ("HeMcs0"));
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  std::vector<Ptr<MultiLinkDevice> > mlds = MultiLinkDeviceHelper::InstallMlds (wifi, channel.Create (), channel.Create (),
+                                                                                "loss", apNode.Get (0), staNodes);
+  Ptr<ConstantPositionMobilityModel> apPosition = CreateObject<ConstantPositionMobilityModel> ();
+  apNode.Get (0)->AggregateObject (apPosition);
+  Ptr<ConstantPositionMobilityModel> staPosition = CreateObject<ConstantPositionMobilityModel> ();
+  staPosition->SetPosition (Vector (5, 0, 0));
+  staNodes.Get (0)->AggregateObject (staPosition);
+
+  mlds[1]->TraceConnectWithoutContext ("Tx", MakeCallback (&MldLinkLossTestCase::Sent, this));
+  mlds[0]->TraceConnectWithoutContext ("Rx", MakeCallback (&MldLinkLossTestCase::Received, this));
+  MultiLinkDeviceHelper::StartDirect (mlds, DataRate ("1Mb/s"), Seconds (1), Seconds (0));
+
+  // once associated, the AP MLD stops receiving anything on link 1: no frame is acknowledged there
+  Ptr<RateErrorModel> loss = CreateObject<RateErrorModel> ();
+  loss->SetUnit (RateErrorModel::ERROR_UNIT_PACKET);
+  loss->SetRate (1.0);
+  Simulator::Schedule (Seconds (1), &WifiPhy::SetPostReceptionErrorModel, mlds[0]->GetSTA1 ()->GetPhy (), loss);
+
+  Simulator::Stop (Seconds (3));
+  Simulator::Run ();
+  uint32_t retransmissions = mlds[1]->GetRetransmissions ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_GT (m_sent.size (), 100, "The STA MLD should have generated traffic");
+  NS_TEST_ASSERT_MSG_GT (retransmissions, 0, "Packets of link 1 should have been retransmitted");
+  uint32_t lost = 0;
+  for (std::set<uint32_t>::iterator it = m_sent.begin (); it != m_sent.end (); ++it)
+    {
+      lost += (m_received.count (*it) == 0) ? 1 : 0;
+    }
+  NS_TEST_ASSERT_MSG_EQ (lost, 0, "Every packet should be delivered on link 2");
+}
+
+// Stop a switching two-link MLD in the middle of a transition and check its airtime covers the elapsed time once
+class MldAirtimeTestCase : public TestCase
+{
+public:
+  MldAirtimeTestCase ();
+  virtual ~MldAirtimeTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CheckAirtime (Ptr<MultiLinkDevice> mld);
+};
+
+MldAirtimeTestCase::MldAirtimeTestCase ()
+  : TestCase ("Airtime of every state of a link sums to the elapsed time, mid-transition included")
+{
+}
+
+MldAirtimeTestCase::~MldAirtimeTestCase ()
+{
+}
+
+void
+MldAirtimeTestCase::CheckAirtime (Ptr<MultiLinkDevice> mld)
+{
+  // the links are accounted from their installation, at time 0
+  for (uint32_t link = 0; link < 2; link++)
+    {
+      Time total = Seconds (0);
+      for (uint32_t state = 0; state < MultiLinkDevice::AIRTIME_STATES; state++)
+        {
+          total += mld->GetAirtime (link, static_cast<MultiLinkDevice::AirtimeState> (state));
+        }
+      NS_TEST_ASSERT_MSG_EQ (total, Simulator::Now (), "Airtime of link " << link + 1 << " should sum to the elapsed time");
+    }
+  NS_TEST_ASSERT_MSG_GT (mld->GetAirtime (0, MultiLinkDevice::AIRTIME_SLEEP), Seconds (0), "The inactive link should sleep");
+  NS_TEST_ASSERT_MSG_GT (mld->GetAirtime (1, MultiLinkDevice::AIRTIME_SWITCHING), Seconds (0), "Transitions should be accounted");
+}
+
+void
+MldAirtimeTestCase::DoRun (void)
+{
+  NodeContainer apNode;
+  apNode.Create (1);
+  NodeContainer staNodes;
+  staNodes.Create (1);
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211ax_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode", StringValue ("HeMcs7"),
+                                "ControlMode", StringValue ("HeMcs0"));
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  std::vector<Ptr<MultiLinkDevice> > mlds = MultiLinkDeviceHelper::InstallMlds (wifi, channel.Create (), channel.Create (),
+                                                                                "airtime", apNode.Get (0), staNodes);
+  Ptr<ConstantPositionMobilityModel> apPosition = CreateObject<ConstantPositionMobilityModel> ();
+  apNode.Get (0)->AggregateObject (apPosition);
+  Ptr<ConstantPositionMobilityModel> staPosition = CreateObject<ConstantPositionMobilityModel> ();
+  staPosition->SetPosition (Vector (5, 0, 0));
+  staNodes.Get (0)->AggregateObject (staPosition);
+
+  // transitions start every 11 ms from 1.010 s and last 1 ms
+  mlds[1]->SetTransitFreq (MilliSeconds (10));
+  mlds[1]->SetTransitDelay (MilliSeconds (1));
+  mlds[1]->SetSleepInactiveLink (true);
+  MultiLinkDeviceHelper::StartDirect (mlds, DataRate ("1Mb/s"), Seconds (1), Seconds (0));
+
+  // half way through the transition to link 2 starting at 1.010 + 40 * 0.011 s
+  Time check = Seconds (1.010) + MilliSeconds (40 * 11) + MicroSeconds (500);
+  Simulator::Schedule (check, &MldAirtimeTestCase::CheckAirtime, this, mlds[1]);
+  Simulator::Stop (check + MicroSeconds (1));
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+// Build the same two-BSS topology with AssignStar and with global routing and compare the next hops
+class StarRoutingTestCase : public TestCase
+{
+public:
+  StarRoutingTestCase ();
+  virtual ~StarRoutingTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /* next hop (gateway, output interface) from every STA to its AP and back */
+  std::vector<std::pair<Ipv4Address, uint32_t> > BuildRoutes (bool star);
+  /* next hop from an interface to an address */
+  std::pair<Ipv4Address, uint32_t> GetNextHop (std::pair<Ptr<Ipv4>, uint32_t> src, Ipv4Address dst);
+};
+
+StarRoutingTestCase::StarRoutingTestCase ()
+  : TestCase ("AssignStar routes like global routing with ARP entries of the own BSS only")
+{
+}
+
+StarRoutingTestCase::~StarRoutingTestCase ()
+{
+}
+
+std::pair<Ipv4Address, uint32_t>
+StarRoutingTestCase::GetNextHop (std::pair<Ptr<Ipv4>, uint32_t> src, Ipv4Address dst)
+{
+  Ipv4Header header;
+  header.SetDestination (dst);
+  Socket::SocketErrno err;
+  Ptr<Ipv4Route> route = src.first->GetRoutingProtocol ()->RouteOutput (Ptr<Packet> (), header, 0, err);
+  if (route == 0)
+    {
+      return std::make_pair (Ipv4Address::GetBroadcast (), 0);
+    }
+  return std::make_pair (route->GetGateway (), src.first->GetInterfaceForDevice (route->GetOutputDevice ()));
+}
+
+std::vector<std::pair<Ipv4Address, uint32_t> >
+StarRoutingTestCase::BuildRoutes (bool star)
+{
+  NodeContainer apNodes;
+  apNodes.Create (2);
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211ax_5GHZ);
+  YansWifiChannelHelper channelHelper = YansWifiChannelHelper::Default ();
+  Ptr<YansWifiChannel> channel = channelHelper.Create ();
+  NetDeviceContainer apDevices;
+  NetDeviceContainer staDevices;
+  std::vector<uint32_t> bssOfSta;
+  InternetStackHelper stack;
+  stack.Install (apNodes);
+  for (uint32_t bss = 0; bss < 2; bss++)
+    {
+      std::ostringstream ssid;
+      ssid << "star-" << bss;
+      NodeContainer staNodes;
+      staNodes.Create (3);
+      stack.Install (staNodes);
+      apDevices.Add (MultiLinkDeviceHelper::InstallLink (wifi, channel, 36, 5180, Ssid (ssid.str ()), true, NodeContainer (apNodes.Get (bss))));
+      staDevices.Add (MultiLinkDeviceHelper::InstallLink (wifi, channel, 36, 5180, Ssid (ssid.str ()), false, staNodes));
+      bssOfSta.insert (bssOfSta.end (), 3, bss);
+    }
+
+  // both BSSs share one subnet, so only the SSID tells the AP of a STA
+  Ipv4AddressHelper address ("10.1.0.0", "255.255.255.0");
+  Ipv4InterfaceContainer apInterfaces, staInterfaces;
+  MultiLinkDeviceHelper helper;
+  if (star)
+    {
+      helper.AssignStar (address, apDevices, staDevices, apInterfaces, staInterfaces);
+      NS_TEST_EXPECT_MSG_EQ (helper.VerifyStar (apInterfaces, staInterfaces), true, "Every STA should reach its AP on-link");
+    }
+  else
+    {
+      staInterfaces = address.Assign (staDevices);
+      apInterfaces = address.Assign (apDevices);
+      Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+    }
+
+  std::vector<std::pair<Ipv4Address, uint32_t> > routes;
+  for (uint32_t sta = 0; sta < staInterfaces.GetN (); sta++)
+    {
+      uint32_t ap = bssOfSta[sta];
+      routes.push_back (GetNextHop (staInterfaces.Get (sta), apInterfaces.GetAddress (ap)));
+      routes.push_back (GetNextHop (apInterfaces.Get (ap), staInterfaces.GetAddress (sta)));
+      if (star)
+        {
+          // the AP of the other BSS is only resolved by ARP, when needed
+          std::pair<Ptr<Ipv4>, uint32_t> interface = staInterfaces.Get (sta);
+          Ptr<ArpCache> cache = interface.first->GetObject<Ipv4L3Protocol> ()->GetInterface (interface.second)->GetArpCache ();
+          NS_TEST_EXPECT_MSG_EQ ((cache->Lookup (apInterfaces.GetAddress (1 - ap)) == 0), true,
+                                 "STA " << sta << " should have no ARP entry for the AP of the other BSS");
+        }
+    }
+  Simulator::Destroy ();
+  return routes;
+}
+
+void
+StarRoutingTestCase::DoRun (void)
+{
+  std::vector<std::pair<Ipv4Address, uint32_t> > global = BuildRoutes (false);
+  std::vector<std::pair<Ipv4Address, uint32_t> > star = BuildRoutes (true);
+  NS_TEST_ASSERT_MSG_EQ (star.size (), global.size (), "Both builds should route the same pairs");
+  for (uint32_t i = 0; i < star.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (star[i].first, global[i].first, "Gateway of route " << i << " differs from global routing");
+      NS_TEST_ASSERT_MSG_EQ (star[i].second, global[i].second, "Interface of route " << i << " differs from global routing");
+      NS_TEST_ASSERT_MSG_EQ (star[i].first, Ipv4Address::GetAny (), "Route " << i << " should be on-link");
+    }
+}
+
+// Account more and more STA MLDs of one topology and check the report grows by one STA MLD each time
+class MldMemoryReportTestCase : public TestCase
+{
+public:
+  MldMemoryReportTestCase ();
+  virtual ~MldMemoryReportTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MldMemoryReportTestCase::MldMemoryReportTestCase ()
+  : TestCase ("Memory report grows by the footprint of a STA MLD per added STA MLD")
+{
+}
+
+MldMemoryReportTestCase::~MldMemoryReportTestCase ()
+{
+}
+
+void
+MldMemoryReportTestCase::DoRun (void)
+{
+  NodeContainer apNode;
+  apNode.Create (1);
+  NodeContainer staNodes;
+  staNodes.Create (4);
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211ax_5GHZ);
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  std::vector<Ptr<MultiLinkDevice> > mlds = MultiLinkDeviceHelper::InstallMlds (wifi, channel.Create (), channel.Create (),
+                                                                                "memory", apNode.Get (0), staNodes);
+  MultiLinkDeviceHelper helper;
+
+  // footprint of one STA MLD alone: its node, itself and its two link devices
+  helper.EnableMemoryAccounting (std::vector<Ptr<MultiLinkDevice> > (1, mlds[1]), Seconds (0));
+  MultiLinkDeviceHelper::MemoryReport single = helper.GetMemoryReport ();
+  NS_TEST_ASSERT_MSG_EQ (single.nodes, 1, "A STA MLD sits on one node");
+  NS_TEST_ASSERT_MSG_EQ (single.linkDevices, 2, "A STA MLD has two link devices");
+  NS_TEST_ASSERT_MSG_EQ (single.mldBytes, mlds[1]->GetMemoryUsage (), "MLD bytes should be those of the MLD");
+  NS_TEST_ASSERT_MSG_GT (single.linkDeviceBytes, 2 * sizeof (WifiNetDevice), "Link devices should count their PHY and MAC");
+  NS_TEST_ASSERT_MSG_EQ (single.queuedPackets, 0, "Nothing is queued before the simulation");
+
+  // the AP MLD, then one more STA MLD at a time
+  helper.EnableMemoryAccounting (std::vector<Ptr<MultiLinkDevice> > (mlds.begin (), mlds.begin () + 1), Seconds (0));
+  MultiLinkDeviceHelper::MemoryReport previous = helper.GetMemoryReport ();
+  for (uint32_t n = 2; n <= mlds.size (); n++)
+    {
+      helper.EnableMemoryAccounting (std::vector<Ptr<MultiLinkDevice> > (mlds.begin (), mlds.begin () + n), Seconds (0));
+      MultiLinkDeviceHelper::MemoryReport report = helper.GetMemoryReport ();
+      NS_TEST_ASSERT_MSG_EQ (report.mlds, n, "Every MLD should be accounted");
+      NS_TEST_ASSERT_MSG_EQ (report.nodes - previous.nodes, single.nodes, "One node more per STA MLD");
+      NS_TEST_ASSERT_MSG_EQ (report.linkDevices - previous.linkDevices, single.linkDevices, "Two link devices more per STA MLD");
+      NS_TEST_ASSERT_MSG_EQ (report.nodeBytes - previous.nodeBytes, single.nodeBytes, "Node bytes should grow by one STA node");
+      NS_TEST_ASSERT_MSG_EQ (report.mldBytes - previous.mldBytes, single.mldBytes, "MLD bytes should grow by one STA MLD");
+      NS_TEST_ASSERT_MSG_EQ (report.linkDeviceBytes - previous.linkDeviceBytes, single.linkDeviceBytes,
+                             "Link device bytes should grow by two STA link devices");
+      NS_TEST_ASSERT_MSG_EQ (report.totalBytes - previous.totalBytes, single.totalBytes, "Total should grow by one STA MLD");
+      previous = report;
+    }
+  Simulator::Destroy ();
+}
+
+// Switch links with the inactive link asleep and check the PHY states around every transition
+class MldSleepTestCase : public TestCase
+{
+public:
+  MldSleepTestCase ();
+  virtual ~MldSleepTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /* the new active link should be awake once its transition is over */
+  void CheckAwake (Ptr<WifiPhy> active);
+  /* the inactive link should sleep during the active period of the other one */
+  void CheckAsleep (Ptr<WifiPhy> inactive);
+  /* a frame is sent by a PHY of the STA MLD, which should be awake */
+  void CheckTransmitted (Ptr<WifiPhy> phy);
+  static void Transmitted (MldSleepTestCase *test, Ptr<WifiPhy> phy, Ptr<const Packet> packet,
+                           uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu, uint16_t staId);
+  void TxDropped (Ptr<const Packet> packet);
+
+  uint32_t m_transmitted;   // frames sent by the STA MLD
+  uint32_t m_dropped;       // frames the PHYs of the STA MLD refused, e.g. asleep
+};
+
+MldSleepTestCase::MldSleepTestCase ()
+  : TestCase ("Inactive eMLSR link sleeps, is woken up by its transition and never transmits asleep"),
+    m_transmitted (0),
+    m_dropped (0)
+{
+}
+
+MldSleepTestCase::~MldSleepTestCase ()
+{
+}
+
+void
+MldSleepTestCase::CheckAwake (Ptr<WifiPhy> active)
+{
+  NS_TEST_EXPECT_MSG_EQ (active->IsStateSleep (), false, "Active link still asleep at " << Simulator::Now ().As (Time::MS));
+}
+
+void
+MldSleepTestCase::CheckAsleep (Ptr<WifiPhy> inactive)
+{
+  NS_TEST_EXPECT_MSG_EQ (inactive->IsStateSleep (), true, "Inactive link awake at " << Simulator::Now ().As (Time::MS));
+}
+
+void
+MldSleepTestCase::Transmitted (MldSleepTestCase *test, Ptr<WifiPhy> phy, Ptr<const Packet> packet,
+                               uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu, uint16_t staId)
+{
+  test->CheckTransmitted (phy);
+}
+
+void
+MldSleepTestCase::CheckTransmitted (Ptr<WifiPhy> phy)
+{
+  m_transmitted++;
+  NS_TEST_EXPECT_MSG_EQ (phy->IsStateSleep (), false, "Frame sent by a sleeping link at " << Simulator::Now ().As (Time::MS));
+}
+
+void
+MldSleepTestCase::TxDropped (Ptr<const Packet> packet)
+{
+  m_dropped++;
+}
+
+void
+MldSleepTestCase::DoRun (void)
+{
+  NodeContainer apNode;
+  apNode.Create (1);
+  NodeContainer staNodes;
+  staNodes.Create (1);
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211ax_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode", StringValue ("HeMcs7"),
+                                "ControlMode", StringValue ("HeMcs0"));
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  std::vector<Ptr<MultiLinkDevice> > mlds = MultiLinkDeviceHelper::InstallMlds (wifi, channel.Create (), channel.Create (),
+                                                                                "sleep", apNode.Get (0), staNodes);
+  Ptr<ConstantPositionMobilityModel> apPosition = CreateObject<ConstantPositionMobilityModel> ();
+  apNode.Get (0)->AggregateObject (apPosition);
+  Ptr<ConstantPositionMobilityModel> staPosition = CreateObject<ConstantPositionMobilityModel> ();
+  staPosition->SetPosition (Vector (5, 0, 0));
+  staNodes.Get (0)->AggregateObject (staPosition);
+
+  Ptr<MultiLinkDevice> sta = mlds[1];
+  Ptr<WifiPhy> phys[2] = { sta->GetSTA1 ()->GetPhy (), sta->GetSTA2 ()->GetPhy () };
+  for (uint32_t link = 0; link < 2; link++)
+    {
+      phys[link]->TraceConnectWithoutContext ("MonitorSnifferTx", MakeBoundCallback (&MldSleepTestCase::Transmitted, this, phys[link]));
+      phys[link]->TraceConnectWithoutContext ("PhyTxDrop", MakeCallback (&MldSleepTestCase::TxDropped, this));
+    }
+
+  // transitions start every 11 ms from 1.010 s and last 1 ms, the first one to link 2
+  sta->SetTransitFreq (MilliSeconds (10));
+  sta->SetTransitDelay (MilliSeconds (1));
+  sta->SetSleepInactiveLink (true);
+  MultiLinkDeviceHelper::StartDirect (mlds, DataRate ("5Mb/s"), Seconds (1), Seconds (0));
+  for (uint32_t n = 0; n < 40; n++)
+    {
+      Time start = Seconds (1.010) + MilliSeconds (11 * n);
+      uint32_t active = (n % 2 == 0) ? 1 : 0;
+      Simulator::Schedule (start + MilliSeconds (1), &MldSleepTestCase::CheckAwake, this, phys[active]);
+      // an ongoing frame of the old link may delay its sleep a little
+      Simulator::Schedule (start + MilliSeconds (6), &MldSleepTestCase::CheckAsleep, this, phys[1 - active]);
+    }
+
+  Simulator::Stop (Seconds (1.5));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_GT (m_transmitted, 0, "The STA MLD should have sent frames");
+  NS_TEST_ASSERT_MSG_EQ (m_dropped, 0, "No frame should be handed to a sleeping PHY");
+}
+
+// Measure HeMcs7 on a link reused from HeMcs0 (ResetLinks) and on a fresh one, as the YansModel sweep does
+class ReusedTopologyTestCase : public TestCase
+{
+public:
+  ReusedTopologyTestCase ();
+  virtual ~ReusedTopologyTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /* throughput (Mbit/s) at HeMcs7 after warming up, on a link first run at HeMcs0 if reuse is set */
+  double Measure (bool reuse);
+  /* offer 80 Mbit/s from the STA to the AP, more than HeMcs7 carries */
+  void Send (Ptr<NetDevice> sta, Address ap);
+  void Received (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                 const Address &from, const Address &to, NetDevice::PacketType packetType);
+
+  uint64_t m_received;      // bytes received by the AP
+};
+
+ReusedTopologyTestCase::ReusedTopologyTestCase ()
+  : TestCase ("A link reused at another rate after ResetLinks measures like a fresh one"),
+    m_received (0)
+{
+}
+
+ReusedTopologyTestCase::~ReusedTopologyTestCase ()
+{
+}
+
+void
+ReusedTopologyTestCase::Send (Ptr<NetDevice> sta, Address ap)
+{
+  sta->Send (Create<Packet> (1000), ap, MultiLinkDevice::PROT_NUMBER);
+  Simulator::Schedule (MicroSeconds (100), &ReusedTopologyTestCase::Send, this, sta, ap);
+}
+
+void
+ReusedTopologyTestCase::Received (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                                  const Address &from, const Address &to, NetDevice::PacketType packetType)
+{
+  m_received += packet->GetSize ();
+}
+
+double
+ReusedTopologyTestCase::Measure (bool reuse)
+{
+  NodeContainer apNode;
+  apNode.Create (1);
+  NodeContainer staNode;
+  staNode.Create (1);
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211ax_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode", StringValue (reuse ? "HeMcs0" : "HeMcs7"),
+                                "ControlMode", StringValue ("HeMcs0"));
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  Ptr<YansWifiChannel> link = channel.Create ();
+  NetDeviceContainer apDevice = MultiLinkDeviceHelper::InstallLink (wifi, link, 36, 5180, Ssid ("reuse"), true, apNode);
+  NetDeviceContainer staDevice = MultiLinkDeviceHelper::InstallLink (wifi, link, 36, 5180, Ssid ("reuse"), false, staNode);
+  Ptr<ConstantPositionMobilityModel> apPosition = CreateObject<ConstantPositionMobilityModel> ();
+  apNode.Get (0)->AggregateObject (apPosition);
+  Ptr<ConstantPositionMobilityModel> staPosition = CreateObject<ConstantPositionMobilityModel> ();
+  staPosition->SetPosition (Vector (5, 0, 0));
+  staNode.Get (0)->AggregateObject (staPosition);
+
+  m_received = 0;
+  apNode.Get (0)->RegisterProtocolHandler (MakeCallback (&ReusedTopologyTestCase::Received, this),
+                                           MultiLinkDevice::PROT_NUMBER, apDevice.Get (0));
+  Simulator::Schedule (Seconds (1), &ReusedTopologyTestCase::Send, this, staDevice.Get (0), apDevice.Get (0)->GetAddress ());
+
+  if (reuse)
+    {
+      // a Block Ack agreement is running at HeMcs0 when the rate changes
+      Simulator::Stop (Seconds (2));
+      Simulator::Run ();
+      NetDeviceContainer devices (apDevice, staDevice);
+      for (uint32_t i = 0; i < devices.GetN (); i++)
+        {
+          DynamicCast<WifiNetDevice> (devices.Get (i))->GetRemoteStationManager ()->SetAttribute ("DataMode", StringValue ("HeMcs7"));
+        }
+      MultiLinkDeviceHelper::ResetLinks (staDevice, apDevice);
+      MultiLinkDeviceHelper::ResetLinks (apDevice, staDevice);
+    }
+  else
+    {
+      Simulator::Stop (Seconds (1));
+      Simulator::Run ();
+    }
+  // the same settling time as the sweep, then one measured second
+  Simulator::Stop (Seconds (0.5));
+  Simulator::Run ();
+  uint64_t base = m_received;
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return (m_received - base) * 8 / 1e6;
+}
+
+void
+ReusedTopologyTestCase::DoRun (void)
+{
+  double fresh = Measure (false);
+  double reused = Measure (true);
+  NS_TEST_ASSERT_MSG_GT (fresh, 10, "HeMcs7 should carry more than HeMcs0 could");
+  NS_TEST_ASSERT_MSG_EQ_TOL (reused, fresh, 0.05 * fresh, "Reused link should measure like a fresh one");
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -61,6 +1180,19 @@ MultiLinkDeviceTestSuite::MultiLinkDeviceTestSuite ()
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new MultiLinkDeviceTestCase1, TestCase::QUICK);
+  AddTestCase (new SpectrumOccupancySinkTestCase, TestCase::QUICK);
+  AddTestCase (new LookupErrorRateModelTestCase, TestCase::QUICK);
+  AddTestCase (new CachedPropagationModelTestCase, TestCase::QUICK);
+  AddTestCase (new MldSequenceDuplicateTestCase, TestCase::QUICK);
+  AddTestCase (new MldPcapWriterTestCase, TestCase::QUICK);
+  AddTestCase (new TimerWheelSchedulerTestCase, TestCase::QUICK);
+  AddTestCase (new TimerWheelBatchTestCase, TestCase::QUICK);
+  AddTestCase (new MldLinkLossTestCase, TestCase::QUICK);
+  AddTestCase (new MldAirtimeTestCase, TestCase::QUICK);
+  AddTestCase (new StarRoutingTestCase, TestCase::QUICK);
+  AddTestCase (new MldMemoryReportTestCase, TestCase::QUICK);
+  AddTestCase (new MldSleepTestCase, TestCase::QUICK);
+  AddTestCase (new ReusedTopologyTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite